@@ -1,4 +1,5 @@
 #pragma GCC optimize("O3", "unroll-loops")
+#include "solver.h"
 #include <memory_resource>
 #include <algorithm>
 #include <iostream>
@@ -6,10 +7,34 @@
 #include <vector>
 #include <queue>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 #include <functional>
 #include <cmath>
 #include <cstring>
+#include <climits>
+#include <array>
+#include <fstream>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <sstream>
+#include <atomic>
+#include <random>
+#include <iomanip>
+#include <numeric>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <csignal>
+#include <condition_variable>
+#include <bit>
+#include <ext/stdio_filebuf.h>
 #define ll long long
 #define vec(type) vector<type>
 #define pb push_back
@@ -18,112 +43,166 @@
 
 using namespace std;
 using namespace chrono;
+using namespace temple_trap;
+
+// Everything but the library interface of solver.h and main has internal linkage.
+// The command-line entry points are [[maybe_unused]] for builds without main.
+namespace {
+
+// ---------------------------------------------------------------------------
+// Search instrumentation, compiled in with -DTEMPLE_TRAP_STATS
+//
+// Every solving thread counts into its own thread_local SearchCounters; solve()
+// resets them per test case and writes them, with the engine's SearchStats, as
+// one JSON line to the error stream. Timers nest: generate_ns includes the
+// heuristic of the successors, and heuristic_ns / hash_ns also cover work done
+// outside the search loop. Without the flag STATS(...) and STATS_TIMER(...)
+// expand to nothing.
+// ---------------------------------------------------------------------------
+
+#ifdef TEMPLE_TRAP_STATS
+struct SearchCounters {
+    const char* engine = "none";
+    long long stale_pops = 0;           // popped with a g above the best known
+    long long inserted = 0;             // successors that improved min_cost
+    long long min_cost_entries = 0;     // min_cost entries written for the first time in this search
+    long long open_high_water = 0;      // largest open list (HDA*: largest of one thread)
+    long long pawn_nodes_visited = 0;   // pawn nodes reached by the floods of for_each_pawn_walk
+    long long pop_ns = 0, generate_ns = 0, heuristic_ns = 0, hash_ns = 0;
+
+    void add(const SearchCounters& other) {
+        stale_pops += other.stale_pops;
+        inserted += other.inserted;
+        min_cost_entries += other.min_cost_entries;
+        open_high_water = max(open_high_water, other.open_high_water);   // per-thread peaks come at different times
+        pawn_nodes_visited += other.pawn_nodes_visited;
+        pop_ns += other.pop_ns;
+        generate_ns += other.generate_ns;
+        heuristic_ns += other.heuristic_ns;
+        hash_ns += other.hash_ns;
+    }
+};
+
+thread_local SearchCounters search_counters;
+
+struct StatsTimer {
+    long long& total;
+    high_resolution_clock::time_point start = high_resolution_clock::now();
+    ~StatsTimer() { total += duration_cast<nanoseconds>(high_resolution_clock::now() - start).count(); }
+};
+
+#define STATS(...) __VA_ARGS__
+#define STATS_CONCAT_(a, b) a##b
+#define STATS_CONCAT(a, b) STATS_CONCAT_(a, b)
+#define STATS_TIMER(field) StatsTimer STATS_CONCAT(stats_timer_, __LINE__){search_counters.field}
+#else
+#define STATS(...)
+#define STATS_TIMER(field)
+#endif
 
 struct GameState;
 
-class Tile {
-protected:
-    vector<int> _top_open;
-    vector<int> _ground_open;
-    bool _hole;
-    int _stairs;
-    int _orient;
-
-    static vector<int> calculate_openings(const vector<int> &openings, int orient) {
-        vector<int> rotated_openings;
-        rotated_openings.reserve(openings.size());
-        for (auto opening : openings) {
-            if (opening == -1) {
-                rotated_openings.pb(-1);
-            } else {
-                int rotated_opening = (opening + orient) % 4;
-                rotated_openings.pb(rotated_opening);
-            }
+// Tiles are flyweights: a board cell holds a 1-byte code (type * 4 + orientation)
+// that indexes a compile-time table of opening masks, hole flag and stairs.
+using TileCode = uint8_t;
+constexpr TileCode NO_TILE = 0xFF;   // the blank
+constexpr int NUM_TILE_TYPES = 8;
+constexpr int NUM_ORIENTATIONS = 4;
+
+struct TileInfo {
+    uint8_t top_mask;     // bit d set when direction d (0=N, 1=E, 2=S, 3=W) is open on top
+    uint8_t ground_mask;  // same for the ground floor
+    bool hole;
+    int8_t stairs;        // direction of the stairs, -1 if none
+};
+
+constexpr uint8_t rotate_openings(uint8_t mask, int orient) {
+    return ((mask << orient) | (mask >> (4 - orient))) & 0xF;
+}
+
+// TILE DEFINITIONS (A-H) as given in the pdf (not the pictures), orientation 0
+constexpr TileInfo BASE_TILES[NUM_TILE_TYPES] = {
+    /* A */ {0b0011, 0b0000, false, -1},
+    /* B */ {0b0011, 0b0000, false, -1},
+    /* C */ {0b0101, 0b0000, false, -1},
+    /* D */ {0b1000, 0b0010, true, 3},
+    /* E */ {0b1000, 0b0010, true, 3},
+    /* F */ {0b0000, 0b0011, true, -1},
+    /* G */ {0b0000, 0b0110, true, -1},
+    /* H */ {0b0000, 0b1100, true, -1},
+};
+constexpr TileInfo EXIT_TILE = {0b0010, 0b0000, true, -1};
+// Stand-in for tiles a pattern database abstracts away. In this table it is
+// open everywhere; a database overrides it with the union of the tiles it hides.
+constexpr TileCode WILDCARD_TILE = NUM_TILE_TYPES * NUM_ORIENTATIONS;
+
+using TileTable = array<TileInfo, WILDCARD_TILE + 1>;
+
+constexpr TileInfo rotate_tile(const TileInfo& base, int orient) {
+    return {
+        rotate_openings(base.top_mask, orient),
+        rotate_openings(base.ground_mask, orient),
+        base.hole,
+        (int8_t)(base.stairs == -1 ? -1 : (base.stairs + orient) % 4),
+    };
+}
+
+constexpr TileTable make_tile_table() {
+    TileTable table{};
+    table[WILDCARD_TILE] = {0b1111, 0b1111, true, 0};
+    for (int type = 0; type < NUM_TILE_TYPES; ++type) {
+        for (int orient = 0; orient < NUM_ORIENTATIONS; ++orient) {
+            table[type * NUM_ORIENTATIONS + orient] = rotate_tile(BASE_TILES[type], orient);
         }
-        return rotated_openings;
     }
+    return table;
+}
 
-public:
-    Tile(const vector<int> & base_top_opens, const vector<int> & base_ground_opens, bool hole, int base_stairs, int orient) {
-        _top_open = calculate_openings(base_top_opens, orient);
-        _ground_open = calculate_openings(base_ground_opens, orient);
-        _hole = hole;
-        _stairs = calculate_openings({base_stairs}, orient)[0];
-        _orient = orient;
-    }
-    virtual ~Tile() = default;
-
-    const vector<int>& getTopOpenings() const { return _top_open; }
-    const vector<int>& getGroundOpenings() const { return _ground_open; }
-    bool hasHole() const { return _hole; }
-    bool hasStairs() const { return (_stairs != -1); }
-    // creating a unique id for each tile
-    int getTileId() const {
-        int id = 0;
-        if(hasStairs()) id += 1000;
-        if(_hole) id += 100;
-        for(int o : _top_open) {
-            if (o >= 0 && o < 4) id |= (1 << o);
-        }
-        for(int o : _ground_open) {
-            if (o >= 0 && o < 4) id |= (1 << (o + 4));
-        }
-        return id;
-    }
-
-    virtual char getTileType() const = 0;
-};
-
-// TILE DEFINITIONS (A-H) as given in the pdf (not the pictures)
-class TileA : public Tile {
-public: TileA(int orient) : Tile({0,1},{},false,-1,orient){} char getTileType() const override { return 'A'; } };
-class TileB : public Tile {
-public: TileB(int orient) : Tile({0, 1},{},false,-1,orient){} char getTileType() const override { return 'B'; } };
-class TileC : public Tile {
-public: TileC(int orient) : Tile({0, 2},{},false,-1,orient){} char getTileType() const override { return 'C'; } };
-class TileD : public Tile {
-public: TileD(int orient) : Tile({3},{1},true,3,orient){} char getTileType() const override { return 'D'; } };
-class TileE : public Tile {
-public: TileE(int orient) : Tile({3},{1},true,3,orient){} char getTileType() const override { return 'E'; } };
-class TileF : public Tile {
-public: TileF(int orient) : Tile({},{0, 1},true,-1,orient){} char getTileType() const override { return 'F'; } };
-class TileG : public Tile {
-public: TileG(int orient) : Tile({},{1, 2},true,-1,orient){} char getTileType() const override { return 'G'; } };
-class TileH : public Tile {
-public: TileH(int orient) : Tile({},{2, 3},true,-1,orient){} char getTileType() const override { return 'H'; } };
-class TileExit : public Tile {
-public: TileExit() : Tile({1}, {}, true, -1, 0) {} char getTileType() const override { return 'X'; } };
+constexpr auto TILE_TABLE = make_tile_table();
+
+constexpr TileCode make_tile_code(char type, int orient) { return (type - 'A') * NUM_ORIENTATIONS + orient; }
+inline const TileInfo& tile_info(TileCode code) { return TILE_TABLE[code]; }
+inline char tile_type(TileCode code) { return 'A' + code / NUM_ORIENTATIONS; }
+inline int tile_orientation(TileCode code) { return code % NUM_ORIENTATIONS; }
 
 using PawnPosition = pair<pair<int, int>, int>;
 
-// Array-based board: 3x3 grid, nullptr means empty
-using BoardConfig = array<array<Tile*, 3>, 3>;
+// Array-based board: 3x3 grid of tile codes, NO_TILE means empty
+using BoardConfig = array<array<TileCode, 3>, 3>;
 
-// Compact board state via encoding
-struct CompactState {
-    uint64_t board_hash;  // Compact board representation
-    int pawn_r, pawn_c, pawn_floor;
-    int blank_r, blank_c;
+constexpr int NUM_CELLS = 9;
+constexpr int BLANK_SLOT = 8;                       // tiles A-H take slots 0-7, the blank is slot 8
+constexpr int NUM_PERMUTATIONS = 362880;            // 9!
+constexpr int PAWN_SLOTS = 19;                      // 9 cells x 2 floors + exit
+constexpr int EXIT_PAWN_SLOT = 18;
+constexpr uint32_t NUM_STATES = (uint32_t)NUM_PERMUTATIONS * PAWN_SLOTS;
 
-    CompactState() = default;
+// Dense state index: permutation rank of the board times pawn slot.
+// Every state maps to a unique integer in [0, NUM_STATES), so search tables can be flat arrays.
+using StateIndex = uint32_t;
 
-    CompactState(const GameState& state);
+static const int factorial[10] = {1, 1, 2, 6, 24, 120, 720, 5040, 40320, 362880};
 
-    bool operator==(const CompactState& other) const {
-        return board_hash == other.board_hash &&
-               pawn_r == other.pawn_r && pawn_c == other.pawn_c && pawn_floor == other.pawn_floor &&
-               blank_r == other.blank_r && blank_c == other.blank_c;
-    }
-};
+inline int tile_slot(TileCode tile) {
+    return tile == NO_TILE ? BLANK_SLOT : tile / NUM_ORIENTATIONS;
+}
 
-struct CompactStateHash {
-    size_t operator()(const CompactState& state) const {
-        size_t h = state.board_hash;
-        h ^= (state.pawn_r * 73856093) ^ (state.pawn_c * 19349663) ^ (state.pawn_floor * 83492791);
-        h ^= (state.blank_r * 50331653) ^ (state.blank_c * 25165843);
-        return h;
+// Lehmer code of the 9 cells (row-major), tiles identified by their letter
+uint32_t permutation_rank(const BoardConfig& board) {
+    uint32_t rank = 0;
+    unsigned used = 0;
+    for (int i = 0; i < NUM_CELLS; ++i) {
+        int v = tile_slot(board[i / 3][i % 3]);
+        rank += (v - __builtin_popcount(used & ((1u << v) - 1))) * factorial[NUM_CELLS - 1 - i];
+        used |= 1u << v;
     }
-};
+    return rank;
+}
+
+inline int pawn_slot(const PawnPosition& pawn) {
+    if (pawn.first.first == 0 && pawn.first.second == -1) return EXIT_PAWN_SLOT;
+    return (pawn.first.first * 3 + pawn.first.second) * 2 + pawn.second;
+}
 
 struct GameState {
     BoardConfig board;
@@ -132,420 +211,794 @@ struct GameState {
     int cost_so_far;
     int heuristic_cost;
 
-    // Caching the compact representation
-    mutable CompactState compact_cache;
-    mutable bool compact_cached = false;
+    // Caching the dense index
+    mutable StateIndex index_cache;
+    mutable bool index_cached = false;
 
-    const CompactState& getCompact() const {
-        if (!compact_cached) {
-            compact_cache = CompactState(*this);
-            compact_cached = true;
+    StateIndex getIndex() const {
+        if (!index_cached) {
+            STATS_TIMER(hash_ns);
+            index_cache = permutation_rank(board) * PAWN_SLOTS + pawn_slot(pawn_pos);
+            index_cached = true;
         }
-        return compact_cache;
+        return index_cache;
     }
 
     bool operator==(const GameState& other) const {
-        return getCompact() == other.getCompact();
+        return getIndex() == other.getIndex();
     }
 };
 
-//  CompactState constructor
-CompactState::CompactState(const GameState& state) {
-    pawn_r = state.pawn_pos.first.first;
-    pawn_c = state.pawn_pos.first.second;
-    pawn_floor = state.pawn_pos.second;
-    blank_r = state.blank_pos.first;
-    blank_c = state.blank_pos.second;
+// Inverse of permutation_rank: fills the tile slot held by each cell
+void unrank_permutation(uint32_t rank, int slots[NUM_CELLS]) {
+    unsigned available = (1u << NUM_CELLS) - 1;
+    for (int i = 0; i < NUM_CELLS; ++i) {
+        int f = factorial[NUM_CELLS - 1 - i];
+        int k = rank / f;
+        rank %= f;
+        unsigned bits = available;
+        while (k--) bits &= bits - 1;
+        int v = __builtin_ctz(bits);
+        slots[i] = v;
+        available &= ~(1u << v);
+    }
+}
 
-    // hashing using position and tile info
-    board_hash = 0;
-    for (int r = 0; r < 3; ++r) {
-        for (int c = 0; c < 3; ++c) {
-            if (state.board[r][c] != nullptr) {
-                int tile_val = state.board[r][c]->getTileType() * 10000 + state.board[r][c]->getTileId();
-                int pos_idx = r * 3 + c;
-                board_hash ^= ((uint64_t)tile_val << (pos_idx * 6));
-            }
+using TileSet = array<TileCode, BLANK_SLOT>;   // tile code of A-H
+
+// Rebuilds the full state from its dense index; costs are filled in by the caller
+GameState decode_state(StateIndex index, const TileSet& tiles) {
+    GameState state;
+    int slots[NUM_CELLS];
+    unrank_permutation(index / PAWN_SLOTS, slots);
+    for (int i = 0; i < NUM_CELLS; ++i) {
+        if (slots[i] == BLANK_SLOT) {
+            state.board[i / 3][i % 3] = NO_TILE;
+            state.blank_pos = {i / 3, i % 3};
+        } else {
+            state.board[i / 3][i % 3] = tiles[slots[i]];
         }
     }
+    int pawn = index % PAWN_SLOTS;
+    if (pawn == EXIT_PAWN_SLOT) state.pawn_pos = {{0, -1}, 1};
+    else state.pawn_pos = {{pawn / 2 / 3, pawn / 2 % 3}, pawn % 2};
+    state.index_cache = index;
+    state.index_cached = true;
+    return state;
 }
 
-struct GameStateHash {
-    size_t operator()(const GameState& state) const {
-        CompactStateHash h;
-        return h(state.getCompact());
+// Dial-style open list for small integer costs. Entries are bare state indices
+// bucketed by f and then by h = f - g, so that within an f bucket the entry with
+// the larger g pops first. Push and pop are O(1) amortized; storage is kept
+// between test cases.
+class BucketQueue {
+    vector<vector<vector<StateIndex>>> buckets;  // [f][h]
+    vector<int> bucket_size;                     // entries per f
+    vector<int> lowest_h;                        // lowest possibly non-empty h per f
+    int current_f = 0;
+    size_t total = 0;
+
+public:
+    bool empty() const { return total == 0; }
+    size_t size() const { return total; }
+
+    void clear() {
+        for (size_t f = 0; f < buckets.size(); ++f) {
+            if (bucket_size[f] == 0) continue;
+            for (auto& bucket : buckets[f]) bucket.clear();
+            bucket_size[f] = 0;
+            lowest_h[f] = INT_MAX;
+        }
+        current_f = 0;
+        total = 0;
+    }
+
+    void push(StateIndex index, int f, int g) {
+        int h = f - g;
+        if (f >= (int)buckets.size()) {
+            buckets.resize(f + 1);
+            bucket_size.resize(f + 1, 0);
+            lowest_h.resize(f + 1, INT_MAX);
+        }
+        auto& by_h = buckets[f];
+        if (h >= (int)by_h.size()) by_h.resize(h + 1);
+        by_h[h].pb(index);
+        bucket_size[f]++;
+        lowest_h[f] = min(lowest_h[f], h);
+        // the heuristic is admissible but not necessarily consistent
+        if (f < current_f || total == 0) current_f = f;
+        total++;
+    }
+
+    // smallest f in the queue; the queue must not be empty
+    int top_f() {
+        while (bucket_size[current_f] == 0) current_f++;
+        return current_f;
     }
-};
 
-struct CompareGameState {
-    bool operator()(const GameState& a, const GameState& b) const {
-        if (a.heuristic_cost != b.heuristic_cost)
-            return a.heuristic_cost > b.heuristic_cost;
-        // Tie-break by cost_so_far
-        return a.cost_so_far < b.cost_so_far;
+    StateIndex pop(int& f, int& g) {
+        while (bucket_size[current_f] == 0) current_f++;
+        auto& by_h = buckets[current_f];
+        int& h = lowest_h[current_f];
+        while (by_h[h].empty()) h++;
+        StateIndex index = by_h[h].back();
+        by_h[h].pop_back();
+        f = current_f;
+        g = current_f - h;
+        if (--bucket_size[current_f] == 0) h = INT_MAX;
+        total--;
+        return index;
     }
 };
 
-/// Heuristic Function
-int calculate_heuristic(const GameState& current_state) {
-    // return 0; // uncomment to compare performance with and without heuristic
-    const pair<int,int>& coords = current_state.pawn_pos.first;
-    const pair<int,int>& blank_tile_pos = current_state.blank_pos;
-    int heuristic  = 0;
-    // standard manhattan
-    heuristic += coords.first  + coords.second +1;
-
-    // If blank tile is on 0,0 then extra cost of atleast one will occur
-    heuristic += (blank_tile_pos.first==0 && blank_tile_pos.second==0) ;
-    // We check if the tile on 0,0 has left top open or not, in case it is not open,
-    // extra cost of atleast manhattan_distance of empty tile to 0,0 + 1 will occur;
-    if (current_state.blank_pos!=make_pair(0,0) ){
-        const vector<int> top_openings_00 = current_state.board[0][0]->getTopOpenings();
-        bool exit_is_open = false;
-        for (int val : top_openings_00) {
-            if (val == 3) {
-                exit_is_open = true;
-                break;
-            }
-        }
-        if (exit_is_open==false) {
-            heuristic += blank_tile_pos.first + blank_tile_pos.second + 1;
+// Flat cost table over the whole state space that empties in O(1). Every entry
+// carries the epoch of the search that wrote it and reads as unset under any
+// other epoch. Costs fit in 16 bits, so epoch and cost share one word and the
+// table keeps 4 bytes per state; it is only wiped when the epoch wraps.
+// Threads may write distinct entries concurrently.
+class EpochCostTable {
+    vector<uint32_t> entries;
+    uint32_t epoch = 0;
+
+public:
+    /// starts a new search: every entry reads as INT_MAX again
+    void next_epoch() {
+        if (entries.empty()) entries.assign(NUM_STATES, 0);
+        if (++epoch == 1u << 16) {
+            fill(all(entries), 0);
+            epoch = 1;
         }
     }
-    return 1*heuristic;
-}
+
+    int get(StateIndex index) const {
+        uint32_t entry = entries[index];
+        return entry >> 16 == epoch ? (int)(entry & 0xFFFF) : INT_MAX;
+    }
+
+    void set(StateIndex index, int cost) { entries[index] = epoch << 16 | cost; }
+};
 
 inline bool is_valid_board_pos(int r, int c) {
     return r >= 0 && r < 3 && c >= 0 && c < 3;
 }
 
-inline bool is_exit_pos(int r, int c) {
-    return r == 0 && c == -1;
-}
+// ---------------------------------------------------------------------------
+// Board geometry
+//
+// The board size and the exit are compile-time parameters: ROWS x COLS cells
+// and an exit just outside one border cell at (EXIT_ROW, EXIT_COL), entered
+// from that cell's top floor. The heuristic, the pawn graph, the walk generator
+// with its pruning and the solution printers take the geometry as a template
+// parameter. The dense engine is their ClassicGeometry instantiation (its state
+// index is written for the classic 3x3 board with the exit left of (0,0)), and
+// other sizes instantiate them through BoardSolver (see "Other board sizes").
+// ---------------------------------------------------------------------------
 
-bool is_valid_and_connected(int r1, int c1, int r2, int c2, int floor, const BoardConfig& board) {
-    // Check if coordinates are in valid range (including exit position)
-    bool pos1_valid = is_valid_board_pos(r1, c1);
-    bool pos2_valid = is_valid_board_pos(r2, c2) || is_exit_pos(r2, c2);
+template <int ROWS, int COLS, int EXIT_ROW, int EXIT_COL>
+struct BoardGeometry {
+    static constexpr int NUM_ROWS = ROWS;
+    static constexpr int NUM_COLS = COLS;
+    static constexpr int NUM_CELLS = ROWS * COLS;
+    static constexpr int NUM_NODES = 2 * NUM_CELLS;   // pawn slots on the board; the exit is slot NUM_NODES
+    static_assert(NUM_NODES <= 32, "pawn nodes must fit a 32-bit mask");
 
-    if (!pos1_valid || !pos2_valid) return false;
-    // Check if tiles exist at both positions
-    Tile* tile1 = nullptr;
-    Tile* tile2 = nullptr;
+    static constexpr bool ROW_OUTSIDE = EXIT_ROW < 0 || EXIT_ROW >= ROWS;
+    static constexpr bool COL_OUTSIDE = EXIT_COL < 0 || EXIT_COL >= COLS;
+    static_assert(ROW_OUTSIDE != COL_OUTSIDE && EXIT_ROW >= -1 && EXIT_ROW <= ROWS && EXIT_COL >= -1 && EXIT_COL <= COLS,
+                  "the exit must lie beside exactly one border cell");
+    static constexpr int LINK_CELL = min(max(EXIT_ROW, 0), ROWS - 1) * COLS + min(max(EXIT_COL, 0), COLS - 1);
+    static constexpr int EXIT_DIR = EXIT_ROW < 0 ? 0 : EXIT_COL >= COLS ? 1 : EXIT_ROW >= ROWS ? 2 : 3;   // N, E, S, W
 
-    if (is_valid_board_pos(r1, c1)) {
-        tile1 = board[r1][c1];
-    }
+    static constexpr int SOUTH_SHIFT = 2 * COLS;
+    static constexpr uint32_t GROUND_NODES = (uint32_t)(0x5555555555555555ull & ((1ull << NUM_NODES) - 1));
+    static constexpr uint32_t TOP_NODES = GROUND_NODES << 1;
+    static constexpr uint32_t EXIT_LINK_NODE = 1u << (LINK_CELL * 2 + 1);
+
+    static constexpr bool on_board(int r, int c) { return r >= 0 && r < ROWS && c >= 0 && c < COLS; }
 
-    if (is_valid_board_pos(r2, c2)) {
-        tile2 = board[r2][c2];
-    } else if (is_exit_pos(r2, c2)) {
-        // tile2 will be set by caller for exit tile
-        return false; // Exit tile handled separately
+    /// Manhattan distance between two cells
+    static constexpr int distance(int a, int b) {
+        int dr = a / COLS - b / COLS, dc = a % COLS - b % COLS;
+        return max(dr, -dr) + max(dc, -dc);
     }
+};
 
-    if (tile1 == nullptr || tile2 == nullptr) return false;
+using ClassicGeometry = BoardGeometry<3, 3, 0, -1>;
 
-    const auto& openings1 = (floor == 0) ? tile1->getGroundOpenings() : tile1->getTopOpenings();
-    const auto& openings2 = (floor == 0) ? tile2->getGroundOpenings() : tile2->getTopOpenings();
+/// Heuristic Function
+/// pawn is a pawn slot (Geometry::NUM_NODES once out), blank the blank's cell
+/// and link_top_mask the top openings of the tile on LINK_CELL, read only when
+/// the blank is elsewhere
+template <typename Geometry = ClassicGeometry>
+int exit_heuristic(int pawn, int blank, uint8_t link_top_mask) {
+    STATS_TIMER(heuristic_ns);
+    // return 0; // uncomment to compare performance with and without heuristic
+    if (pawn == Geometry::NUM_NODES) return 0;
+    constexpr int link = Geometry::LINK_CELL;
+    // standard manhattan to the link cell, plus the step out through the exit
+    int heuristic = Geometry::distance(pawn / 2, link) + 1;
 
-    if (r1 == r2) {
-        if (c2 > c1) {
-            // East: tile1 needs 1 (E), tile2 needs 3 (W)
-            bool has1 = false, has2 = false;
-            for (int o : openings1) if (o == 1) { has1 = true; break; }
-            for (int o : openings2) if (o == 3) { has2 = true; break; }
-            return has1 && has2;
-        } else {
-            // West: tile1 needs 3 (W), tile2 needs 1 (E)
-            bool has1 = false, has2 = false;
-            for (int o : openings1) if (o == 3) { has1 = true; break; }
-            for (int o : openings2) if (o == 1) { has2 = true; break; }
-            return has1 && has2;
-        }
-    } else if (c1 == c2) {
-        if (r2 > r1) {
-            // South: tile1 needs 2 (S), tile2 needs 0 (N)
-            bool has1 = false, has2 = false;
-            for (int o : openings1) if (o == 2) { has1 = true; break; }
-            for (int o : openings2) if (o == 0) { has2 = true; break; }
-            return has1 && has2;
-        } else {
-            // North: tile1 needs 0 (N), tile2 needs 2 (S)
-            bool has1 = false, has2 = false;
-            for ( int o : openings1) if (o == 0) { has1 = true; break; }
-            for (int o : openings2) if (o == 2) { has2 = true; break; }
-            return has1 && has2;
-        }
-    }
-    return false;
+    // If blank tile is on the link cell then extra cost of atleast one will occur
+    if (blank == link) return heuristic + 1;
+    // We check if the tile on the link cell is open towards the exit or not, in case it is not open,
+    // extra cost of atleast manhattan_distance of empty tile to the link cell + 1 will occur;
+    bool exit_is_open = link_top_mask >> Geometry::EXIT_DIR & 1;
+    if (exit_is_open == false) heuristic += Geometry::distance(blank, link) + 1;
+    return heuristic;
 }
 
-/// check if tile is connected to exit
-bool is_connected_to_exit(int r1, int c1, int floor, const BoardConfig& board, Tile* exit_tile) {
-    if (!is_valid_board_pos(r1, c1)) return false;
+int calculate_heuristic(const GameState& current_state) {
+    int blank = current_state.blank_pos.first * 3 + current_state.blank_pos.second;
+    uint8_t link_top_mask = blank == 0 ? 0 : tile_info(current_state.board[0][0]).top_mask;
+    return exit_heuristic(pawn_slot(current_state.pawn_pos), blank, link_top_mask);
+}
 
-    Tile* tile1 = board[r1][c1];
-    if (tile1 == nullptr) return false;
+// ---------------------------------------------------------------------------
+// Bitboard pawn graph
+//
+// The pawn nodes (cells x 2 floors, 18 on the classic board) are bits of a
+// mask, numbered like pawn_slot: bit cell * 2 + floor. Moving one cell east is
+// a shift by 2, one cell south a shift by 2 * COLS (6 on the classic board) and
+// taking the stairs flips the lowest bit.
+// ---------------------------------------------------------------------------
 
-    const auto& openings1 = (floor == 0) ? tile1->getGroundOpenings() : tile1->getTopOpenings();
-    const auto& openings2 = (floor == 0) ? exit_tile->getGroundOpenings() : exit_tile->getTopOpenings();
+constexpr uint32_t GROUND_NODES = ClassicGeometry::GROUND_NODES;    // even bits
+constexpr uint32_t TOP_NODES = ClassicGeometry::TOP_NODES;          // odd bits
+constexpr uint32_t EXIT_LINK_NODE = ClassicGeometry::EXIT_LINK_NODE;  // top floor of (0,0)
+static_assert(GROUND_NODES == 0x15555 && EXIT_LINK_NODE == 1u << 1 && ClassicGeometry::EXIT_DIR == 3);
 
-    // Exit is at (0, -1), so we're moving West from (0, 0)
-    // tile1 needs 3, tile2 needs 1
-    bool has1 = false, has2 = false;
-    for (int o : openings1) if (o == 3) { has1 = true; break; }
-    for (int o : openings2) if (o == 1) { has2 = true; break; }
-    return has1 && has2;
-}
-/// hashing the pawn position
-struct PawnPositionHash {
-    size_t operator()(const PawnPosition& pos) const {
-        return (pos.first.first * 73856093) ^ (pos.first.second * 19349663) ^ (pos.second * 83492791);
-    }
+struct PawnGraph {
+    uint32_t east = 0;       // nodes linked to the same floor one cell east
+    uint32_t south = 0;      // nodes linked to the same floor one cell south
+    uint32_t stairs = 0;     // both nodes of every cell with stairs
+    uint32_t holes = 0;      // ground nodes of every cell with a hole
+    bool exit_open = false;  // top floor of the link cell ((0,0) on the classic board) links to the exit
 };
 
-static TileExit global_exit_tile;
-/// returns states after valid pawn moves
-vector<GameState> find_pawn_moves(const GameState& current_state) {
-    vector<GameState> possible_new_states;
-    possible_new_states.reserve(20);
-
-    const auto& board = current_state.board;
-    const auto& start_pos = current_state.pawn_pos;
-
-    Tile* exit_tile = &global_exit_tile;
-    const pair<int,int> exit_coords = {0, -1};
+/// the pawn graph of the board whose cell c holds tile_at(c), NO_TILE for the
+/// blank, read through table (TILE_TABLE, a pattern database's or a tile file's)
+template <typename Geometry = ClassicGeometry, typename TileAt, typename Table = TileTable>
+PawnGraph pawn_graph_of(TileAt&& tile_at, const Table& table = TILE_TABLE) {
+    constexpr int CELLS = Geometry::NUM_CELLS, COLS = Geometry::NUM_COLS;
+    TileCode codes[CELLS];
+    for (int cell = 0; cell < CELLS; ++cell) codes[cell] = tile_at(cell);
+    PawnGraph graph;
+    for (int cell = 0; cell < CELLS; ++cell) {
+        if (codes[cell] == NO_TILE) continue;
+        const TileInfo& tile = table[codes[cell]];
+        int ground = cell * 2;
+        // East: tile needs 1 (E), neighbour needs 3 (W); South: 2 (S) and 0 (N)
+        if (cell % COLS + 1 < COLS && codes[cell + 1] != NO_TILE) {
+            const TileInfo& east = table[codes[cell + 1]];
+            if ((tile.ground_mask >> 1) & (east.ground_mask >> 3) & 1) graph.east |= 1u << ground;
+            if ((tile.top_mask >> 1) & (east.top_mask >> 3) & 1) graph.east |= 1u << (ground + 1);
+        }
+        if (cell + COLS < CELLS && codes[cell + COLS] != NO_TILE) {
+            const TileInfo& south = table[codes[cell + COLS]];
+            if ((tile.ground_mask >> 2) & south.ground_mask & 1) graph.south |= 1u << ground;
+            if ((tile.top_mask >> 2) & south.top_mask & 1) graph.south |= 1u << (ground + 1);
+        }
+        if (tile.stairs != -1) graph.stairs |= 3u << ground;
+        if (tile.hole) graph.holes |= 1u << ground;
+    }
+    // The exit lies beside LINK_CELL in direction EXIT_DIR (West of (0, 0) on the
+    // classic board): the tile needs EXIT_DIR, the exit tile turned to face the
+    // board needs the opposite direction
+    constexpr int link = Geometry::LINK_CELL, dir = Geometry::EXIT_DIR;
+    constexpr uint8_t exit_openings = rotate_openings(EXIT_TILE.top_mask, (dir + 1) % 4);
+    graph.exit_open = codes[link] != NO_TILE && (table[codes[link]].top_mask >> dir & 1) &&
+                      (exit_openings >> (dir + 2) % 4 & 1);
+    return graph;
+}
 
-    static PawnPosition bfs_queue[1000];
-    static int bfs_cost[1000];
-    int head = 0, tail = 0;
+PawnGraph build_pawn_graph(const BoardConfig& board, const TileTable& table = TILE_TABLE) {
+    return pawn_graph_of([&](int cell) { return board[cell / 3][cell % 3]; }, table);
+}
 
-    unordered_map<PawnPosition, int, PawnPositionHash> min_walk_costs;
-    min_walk_costs.reserve(50);
+/// adds the other floor of every node standing on stairs (stairs cost nothing)
+template <typename Geometry = ClassicGeometry>
+inline uint32_t take_stairs(uint32_t nodes, const PawnGraph& graph) {
+    uint32_t on_stairs = nodes & graph.stairs;
+    return nodes | ((on_stairs & Geometry::GROUND_NODES) << 1) | ((on_stairs & Geometry::TOP_NODES) >> 1);
+}
 
-    bfs_queue[tail] = start_pos;
-    bfs_cost[tail] = 0;
-    tail++;
-    min_walk_costs[start_pos] = 0;
+/// all nodes one walking step away from any node in the set
+template <typename Geometry = ClassicGeometry>
+inline uint32_t step_once(uint32_t nodes, const PawnGraph& graph) {
+    constexpr int south = Geometry::SOUTH_SHIFT;
+    return ((nodes & graph.east) << 2) | ((nodes >> 2) & graph.east) |
+           ((nodes & graph.south) << south) | ((nodes >> south) & graph.south);
+}
 
-    static const int dr[] = {-1, 0, 1, 0};
-    static const int dc[] = {0, 1, 0, -1};
+/// layered flood fill from a set of nodes; calls visit(layer, walk_cost) once per
+/// distance, where layer holds exactly the nodes first reached at that cost
+template <typename Geometry = ClassicGeometry, typename Visit>
+void flood_pawn_graph(const PawnGraph& graph, uint32_t start, Visit&& visit) {
+    uint32_t frontier = take_stairs<Geometry>(start, graph);
+    uint32_t visited = frontier;
+    for (int walk_cost = 0; frontier != 0; ++walk_cost) {
+        visit(frontier, walk_cost);
+        frontier = take_stairs<Geometry>(step_once<Geometry>(frontier, graph), graph) & ~visited;
+        visited |= frontier;
+    }
+}
 
-    while (head < tail) {
-        PawnPosition current_pos = bfs_queue[head];
-        int current_walk_cost = bfs_cost[head];
-        head++;
+// Arrival moves: a searched state records only the move that reached it, which
+// is enough to step back to its parent. 0-3: the blank moved in direction d
+// (N, E, S, W); PAWN_ARRIVAL + s: the pawn walked here from pawn slot s.
+using MoveCode = uint8_t;
+constexpr MoveCode PAWN_ARRIVAL = 4;
+constexpr MoveCode NO_ARRIVAL = 0xFF;   // the start state
 
-        auto current_coords = current_pos.first;
-        auto current_floor = current_pos.second;
-        int cr = current_coords.first;
-        int cc = current_coords.second;
+// Move pruning. Given the move that reached a state, the generators skip
+// successors that some other path reaches at no higher cost:
+// - the slide that undoes the arriving slide leads back to the parent;
+// - after a pawn walk, a second walk on the same board is never cheaper than
+//   one direct walk from the first walk's start;
+// - after a slide whose tile lands outside the pawn's reachable region, every
+//   walk was already possible before the slide at no higher cost (the region
+//   only lost the links of the cell that is now blank), so the walk is made
+//   first instead.
+// Every rewrite moves pawn walks earlier on the path, so an optimal path
+// survives that none of the rules cuts. Every generator (GameState, packed
+// word, IDA*'s in-place state and BoardSolver) applies the rules through
+// for_each_pawn_walk and for_each_slide.
 
-        if (min_walk_costs[current_pos] < current_walk_cost) continue;
+/// row and column step of the blank for each slide direction (N, E, S, W)
+constexpr int SLIDE_DR[4] = {-1, 0, 1, 0};
+constexpr int SLIDE_DC[4] = {0, 1, 0, -1};
 
-        for (int i = 0; i < 4; ++i) {
-            int nr = cr + dr[i];
-            int nc = cc + dc[i];
-
-            if (is_valid_board_pos(nr, nc)) {
-                PawnPosition neighbor_pos = {{nr, nc}, current_floor};
-                int next_walk_cost = current_walk_cost + 1;
-
-                if (is_valid_and_connected(cr, cc, nr, nc, current_floor, board)) {
-                    auto it = min_walk_costs.find(neighbor_pos);
-                    if (it == min_walk_costs.end() || next_walk_cost < it->second) {
-                        min_walk_costs[neighbor_pos] = next_walk_cost;
-                        if (tail < 1000) {
-                            bfs_queue[tail] = neighbor_pos;
-                            bfs_cost[tail] = next_walk_cost;
-                            tail++;
-                        }
-                    }
-                }
-            }
-        }
+/// the slide in direction d moves back the tile the arriving slide just moved
+inline bool undoes_arrival(MoveCode arrival, int d) {
+    return arrival < PAWN_ARRIVAL && d == (arrival + 2) % 4;
+}
 
-        // Explore Stairs
-        if (is_valid_board_pos(cr, cc) && board[cr][cc] != nullptr && board[cr][cc]->hasStairs()) {
-            PawnPosition other_floor_pos = {{cr, cc}, 1 - current_floor};
-            int next_walk_cost = current_walk_cost;
-            auto it = min_walk_costs.find(other_floor_pos);
-            if (it == min_walk_costs.end() || next_walk_cost < it->second) {
-                min_walk_costs[other_floor_pos] = next_walk_cost;
-                if (tail < 1000) {
-                    bfs_queue[tail] = other_floor_pos;
-                    bfs_cost[tail] = next_walk_cost;
-                    tail++;
-                }
-            }
+/// calls slide(d, from) for every slide the pruning rules keep: the blank at
+/// cell blank moves in direction d and the tile on cell from takes its place.
+/// The tile under the pawn (on cell pawn_cell) stays put; pruned counts the
+/// slides skipped. A slide callback that returns bool stops the loop by
+/// returning true.
+template <typename Geometry = ClassicGeometry, typename Slide>
+void for_each_slide(int blank, int pawn_cell, MoveCode arrival, long long* pruned, Slide&& slide) {
+    constexpr int COLS = Geometry::NUM_COLS;
+    int br = blank / COLS, bc = blank % COLS;
+    for (int d = 0; d < 4; ++d) {
+        int nr = br + SLIDE_DR[d], nc = bc + SLIDE_DC[d];
+        int from = nr * COLS + nc;
+        if (!Geometry::on_board(nr, nc) || from == pawn_cell) continue;
+        if (undoes_arrival(arrival, d)) {
+            if (pruned) ++*pruned;
+            continue;
         }
-
-        // Special Exit Check
-        if (cr == 0 && cc == 0 && current_floor == 1) {
-            PawnPosition exit_pawn_pos = {exit_coords, 1};
-            int next_walk_cost = current_walk_cost + 1;
-
-            if (is_connected_to_exit(cr, cc, 1, board, exit_tile)) {
-                auto it = min_walk_costs.find(exit_pawn_pos);
-                if (it == min_walk_costs.end() || next_walk_cost < it->second) {
-                    min_walk_costs[exit_pawn_pos] = next_walk_cost;
-                }
-            }
+        if constexpr (is_same_v<decltype(slide(d, from)), bool>) {
+            if (slide(d, from)) return;
+        } else {
+            slide(d, from);
         }
     }
+}
 
-    for (const auto& [end_pos, walk_cost] : min_walk_costs) {
-        auto end_coords = end_pos.first;
-        auto end_floor = end_pos.second;
-        int er = end_coords.first;
-        int ec = end_coords.second;
+/// calls add_walk(end_slot, cost) for every pawn walk from pawn slot pawn that
+/// the pruning rules keep: to the ground floor of a hole, or out through the
+/// exit (slot Geometry::NUM_NODES, EXIT_PAWN_SLOT on the classic board); blank
+/// is the blank's cell. make_graph() is called only when some walk is generated
+/// or counted; pruned counts the walks skipped.
+template <typename Geometry = ClassicGeometry, typename MakeGraph, typename AddWalk>
+void for_each_pawn_walk(MakeGraph&& make_graph, int pawn, int blank, MoveCode arrival, long long* pruned, AddWalk&& add_walk) {
+    constexpr int COLS = Geometry::NUM_COLS;
+    // after a walk every walk is pruned; the flood below would only count them
+    if (arrival != NO_ARRIVAL && arrival >= PAWN_ARRIVAL && !pruned) return;
 
-        bool is_resting_spot = (walk_cost > 0 && end_floor == 0 && !is_exit_pos(er, ec) &&
-                                is_valid_board_pos(er, ec) && board[er][ec] != nullptr && board[er][ec]->hasHole());
-        bool is_exit_spot = is_exit_pos(er, ec);
+    // a single flood serves both the pruning test and the moves: layers[d] holds
+    // the nodes first reached at walk cost d
+    const PawnGraph graph = make_graph();
+    uint32_t start = 1u << pawn;
+    uint32_t layers[Geometry::NUM_NODES];
+    int num_layers = 0;
+    uint32_t region = 0;
+    flood_pawn_graph<Geometry>(graph, start, [&](uint32_t layer, int) {
+        layers[num_layers++] = layer;
+        region |= layer;
+    });
+    STATS(search_counters.pawn_nodes_visited += __builtin_popcount(region));
 
-        if (is_resting_spot || is_exit_spot) {
-            GameState new_state = current_state;
-            new_state.pawn_pos = end_pos;
-            new_state.cost_so_far = current_state.cost_so_far + walk_cost;
-            int h = calculate_heuristic(new_state);
-            new_state.heuristic_cost = new_state.cost_so_far + h;
-            new_state.compact_cached = false;
-            possible_new_states.push_back(move(new_state));
+    if (arrival != NO_ARRIVAL) {
+        bool commutes = arrival >= PAWN_ARRIVAL ||
+                        !(region & (3u << ((blank / COLS - SLIDE_DR[arrival]) * COLS + blank % COLS - SLIDE_DC[arrival]) * 2));
+        if (commutes) {
+            if (pruned) *pruned += __builtin_popcount(region & graph.holes & ~start) + (graph.exit_open && (region & Geometry::EXIT_LINK_NODE));
+            return;
         }
     }
-    return possible_new_states;
-}
 
+    for (int walk_cost = 0; walk_cost < num_layers; ++walk_cost) {
+        uint32_t layer = layers[walk_cost];
+        // resting spots are holes on the ground floor, reached by a real walk
+        if (walk_cost > 0) {
+            for (uint32_t spots = layer & graph.holes; spots; spots &= spots - 1) add_walk(__builtin_ctz(spots), walk_cost);
+        }
+        // Special Exit Check
+        if (graph.exit_open && (layer & Geometry::EXIT_LINK_NODE)) add_walk(Geometry::NUM_NODES, walk_cost + 1);
+    }
+}
 
-/// returns states after valid tile slides
-vector<GameState> find_tile_slides(const GameState& current_state) {
-    vector<GameState> possible_new_states;
-    possible_new_states.reserve(4);
-
-    const auto& blank_pos = current_state.blank_pos;
-    const auto& pawn_pos = current_state.pawn_pos;
+// Fixed-capacity successor list owned by the caller, so expanding a state does
+// not touch the heap: at most one walk per tile with a hole plus the exit, and
+// four slides.
+constexpr int MAX_SUCCESSORS = NUM_TILE_TYPES + 1 + 4;
 
-    int br = blank_pos.first;
-    int bc = blank_pos.second;
+struct SuccessorBuffer {
+    array<GameState, MAX_SUCCESSORS> states;
+    int count = 0;
 
-    static const int dr[] = {-1, 0, 1, 0};
-    static const int dc[] = {0, 1, 0, -1};
+    void clear() { count = 0; }
+    GameState& add() { return states[count++]; }
+    GameState* begin() { return states.data(); }
+    GameState* end() { return states.data() + count; }
+};
 
-    for (int i = 0; i < 4; ++i) {
-        int nr = br + dr[i];
-        int nc = bc + dc[i];
+/// appends the states after valid pawn moves; pruned counts the moves skipped
+void find_pawn_moves(const GameState& current_state, SuccessorBuffer& successors, MoveCode arrival = NO_ARRIVAL, long long* pruned = nullptr) {
+    int blank = current_state.blank_pos.first * 3 + current_state.blank_pos.second;
+    for_each_pawn_walk([&] { return build_pawn_graph(current_state.board); }, pawn_slot(current_state.pawn_pos), blank,
+                       arrival, pruned, [&](int end_slot, int walk_cost) {
+        GameState& new_state = successors.add();
+        new_state = current_state;
+        // holes are on the ground floor
+        new_state.pawn_pos = end_slot == EXIT_PAWN_SLOT ? PawnPosition{{0, -1}, 1}
+                                                        : PawnPosition{{end_slot / 2 / 3, end_slot / 2 % 3}, 0};
+        new_state.cost_so_far = current_state.cost_so_far + walk_cost;
+        int h = calculate_heuristic(new_state);
+        new_state.heuristic_cost = new_state.cost_so_far + h;
+        new_state.index_cached = false;
+    });
+}
 
-        if (!is_valid_board_pos(nr, nc)) continue;
-        if (nr == pawn_pos.first.first && nc == pawn_pos.first.second) continue;
 
-        GameState new_state = current_state;
+/// appends the states after valid tile slides; pruned counts the moves skipped
+void find_tile_slides(const GameState& current_state, SuccessorBuffer& successors, MoveCode arrival = NO_ARRIVAL, long long* pruned = nullptr) {
+    auto [br, bc] = current_state.blank_pos;
+    auto [pr, pc] = current_state.pawn_pos.first;
+    for_each_slide(br * 3 + bc, pr * 3 + pc, arrival, pruned, [&](int, int from) {
+        int nr = from / 3, nc = from % 3;
+        GameState& new_state = successors.add();
+        new_state = current_state;
         new_state.board[br][bc] = new_state.board[nr][nc];
-        new_state.board[nr][nc] = nullptr;
+        new_state.board[nr][nc] = NO_TILE;
         new_state.blank_pos = {nr, nc};
         new_state.cost_so_far = current_state.cost_so_far + 1;
         int h = calculate_heuristic(new_state);
         new_state.heuristic_cost = new_state.cost_so_far + h;
-        new_state.compact_cached = false;
-        possible_new_states.push_back(move(new_state));
+        new_state.index_cached = false;
+    });
+}
+
+/// fills the buffer with every successor, pawn moves first
+void find_successors(const GameState& state, SuccessorBuffer& successors, MoveCode arrival = NO_ARRIVAL, long long* pruned = nullptr) {
+    successors.clear();
+    find_pawn_moves(state, successors, arrival, pruned);
+    find_tile_slides(state, successors, arrival, pruned);
+}
+
+// ---------------------------------------------------------------------------
+// Packed state word
+//
+// The A* loops keep a state in one uint64_t: 4 bits per cell in row-major
+// order holding the cell's tile slot (A-H = 0-7, BLANK_SLOT for the blank),
+// then 5 bits of pawn slot and 4 bits of blank cell. The tile set maps slots to
+// tile codes. A slide swaps two nibbles and a pawn move rewrites the pawn
+// field. The goal test and the heuristic read fields, and the dense index is
+// ranked straight from the nibbles. A popped index is unranked into a word;
+// GameState is decoded only to rebuild and print the solution path.
+// ---------------------------------------------------------------------------
+
+using PackedState = uint64_t;
+constexpr int PACKED_PAWN_SHIFT = 4 * NUM_CELLS;
+constexpr int PACKED_BLANK_SHIFT = PACKED_PAWN_SHIFT + 5;
+
+inline int packed_slot(PackedState state, int cell) { return state >> (4 * cell) & 15; }
+inline int packed_pawn(PackedState state) { return state >> PACKED_PAWN_SHIFT & 31; }
+inline int packed_blank(PackedState state) { return state >> PACKED_BLANK_SHIFT & 15; }
+inline bool packed_is_goal(PackedState state) { return packed_pawn(state) == EXIT_PAWN_SLOT; }
+
+/// the word of a dense index
+PackedState unpack_index(StateIndex index) {
+    int slots[NUM_CELLS];
+    unrank_permutation(index / PAWN_SLOTS, slots);
+    PackedState state = (PackedState)(index % PAWN_SLOTS) << PACKED_PAWN_SHIFT;
+    for (int cell = 0; cell < NUM_CELLS; ++cell) {
+        state |= (PackedState)slots[cell] << (4 * cell);
+        if (slots[cell] == BLANK_SLOT) state |= (PackedState)cell << PACKED_BLANK_SHIFT;
+    }
+    return state;
+}
+
+/// dense index of a word: permutation_rank over the nibbles
+StateIndex packed_index(PackedState state) {
+    STATS_TIMER(hash_ns);
+    uint32_t rank = 0;
+    unsigned used = 0;
+    for (int cell = 0; cell < NUM_CELLS; ++cell) {
+        int v = packed_slot(state, cell);
+        rank += (v - __builtin_popcount(used & ((1u << v) - 1))) * factorial[NUM_CELLS - 1 - cell];
+        used |= 1u << v;
     }
-    return possible_new_states;
+    return rank * PAWN_SLOTS + packed_pawn(state);
+}
+
+/// calculate_heuristic on a word
+int packed_heuristic(PackedState state, const TileSet& tiles) {
+    int blank = packed_blank(state);
+    uint8_t link_top_mask = blank == 0 ? 0 : tile_info(tiles[packed_slot(state, 0)]).top_mask;
+    return exit_heuristic(packed_pawn(state), blank, link_top_mask);
+}
+
+PawnGraph packed_pawn_graph(PackedState state, const TileSet& tiles) {
+    return pawn_graph_of([&](int cell) {
+        int slot = packed_slot(state, cell);
+        return slot == BLANK_SLOT ? NO_TILE : tiles[slot];
+    });
+}
+
+/// a successor word with the cost of its move and the arrival move it records
+struct PackedMove {
+    PackedState state;
+    int cost;
+    MoveCode arrival;
+};
+
+struct PackedSuccessors {
+    array<PackedMove, MAX_SUCCESSORS> moves;
+    int count = 0;
+
+    void add(PackedState state, int cost, MoveCode arrival) { moves[count++] = {state, cost, arrival}; }
+    PackedMove* begin() { return moves.data(); }
+    PackedMove* end() { return moves.data() + count; }
+};
+
+/// find_successors on a word, with the same pruning: pawn moves, then slides
+void find_packed_successors(PackedState state, const TileSet& tiles, PackedSuccessors& successors,
+                            MoveCode arrival = NO_ARRIVAL, long long* pruned = nullptr) {
+    successors.count = 0;
+    int pawn = packed_pawn(state), blank = packed_blank(state);
+
+    // pawn moves, as in find_pawn_moves
+    PackedState board = state & ~(31ull << PACKED_PAWN_SHIFT);
+    MoveCode walk = PAWN_ARRIVAL + pawn;
+    for_each_pawn_walk([&] { return packed_pawn_graph(state, tiles); }, pawn, blank, arrival, pruned,
+                       [&](int end_slot, int walk_cost) {
+        successors.add(board | (PackedState)end_slot << PACKED_PAWN_SHIFT, walk_cost, walk);
+    });
+
+    // slides, as in find_tile_slides: the tile beside the blank moves into it
+    for_each_slide(blank, pawn / 2, arrival, pruned, [&](int d, int from) {
+        PackedState tile = packed_slot(state, from);
+        PackedState next = state & ~(15ull << (4 * blank)) & ~(15ull << (4 * from)) & ~(15ull << PACKED_BLANK_SHIFT);
+        next |= tile << (4 * blank) | (PackedState)BLANK_SLOT << (4 * from) | (PackedState)from << PACKED_BLANK_SHIFT;
+        successors.add(next, 1, d);
+    });
 }
 
 bool is_goal_state(const GameState& current_state) {
     return current_state.pawn_pos.first == make_pair(0, -1);
 }
 
-void print_board(const GameState& state) {
-    if (state.pawn_pos.first == make_pair(0, -1)) {
-        cout << "  Cost: " << state.cost_so_far << endl;
-        cout << "  PAWN HAS EXITED!" << endl;
+/// one position of a solution path as the printers see it
+template <typename Geometry>
+struct BoardView {
+    array<TileCode, Geometry::NUM_CELLS> cells;   // NO_TILE for the blank
+    int blank;   // cell of the blank
+    int pawn;    // pawn slot, Geometry::NUM_NODES once out
+    int cost;    // cost so far
+};
+
+BoardView<ClassicGeometry> board_view(const GameState& state) {
+    BoardView<ClassicGeometry> view;
+    for (int cell = 0; cell < NUM_CELLS; ++cell) view.cells[cell] = state.board[cell / 3][cell % 3];
+    view.blank = state.blank_pos.first * 3 + state.blank_pos.second;
+    view.pawn = pawn_slot(state.pawn_pos);
+    view.cost = state.cost_so_far;
+    return view;
+}
+
+template <typename Geometry>
+void print_board(const BoardView<Geometry>& state, ostream& out) {
+    out << "  Cost: " << state.cost << '\n';
+    if (state.pawn == Geometry::NUM_NODES) {
+        out << "  PAWN HAS EXITED!" << '\n';
         return;
     }
-    cout << "  Cost: " << state.cost_so_far << endl;
-    for (int r = 0; r < 3; ++r) {
-        cout << "  ";
-        for (int c = 0; c < 3; ++c) {
-            if (r == state.pawn_pos.first.first && c == state.pawn_pos.first.second) {
-                char tile_type = '?';
-                if (state.board[r][c] != nullptr) tile_type = state.board[r][c]->getTileType();
-                cout << "[P" << state.pawn_pos.second << tile_type << "]";
-            } else if (r == state.blank_pos.first && c == state.blank_pos.second) {
-                cout << "[   ]";
+    for (int r = 0; r < Geometry::NUM_ROWS; ++r) {
+        out << "  ";
+        for (int c = 0; c < Geometry::NUM_COLS; ++c) {
+            int cell = r * Geometry::NUM_COLS + c;
+            TileCode tile = state.cells[cell];
+            if (cell == state.pawn / 2) {
+                char type = '?';
+                if (tile != NO_TILE) type = tile_type(tile);
+                out << "[P" << state.pawn % 2 << type << "]";
+            } else if (cell == state.blank) {
+                out << "[   ]";
             } else {
-                if (state.board[r][c] != nullptr) {
-                    char tile_type = state.board[r][c]->getTileType();
-                    cout << "[ " << tile_type << " ]";
+                if (tile != NO_TILE) {
+                    out << "[ " << tile_type(tile) << " ]";
                 } else {
-                    cout << "[???]";
+                    out << "[???]";
                 }
             }
         }
-        cout << endl;
+        out << '\n';
     }
 }
 
-void print_path(GameState end_state, unordered_map<CompactState, GameState, CompactStateHash>& parent_map, const GameState& initial_state) {
-    vector<GameState> path;
-    GameState current = end_state;
+// An anytime answer carries its suboptimality bound (cost / proven lower bound,
+// 1 when proven optimal, rounded up when printed); exact engines pass bound 0
+// and print none.
+template <typename Geometry>
+void print_path(const vector<BoardView<Geometry>>& path, ostream& out, double bound = 0) {
+    out << "--- SOLUTION PATH ---" << '\n';
+    out << "Total Cost: " << path.back().cost << " (in " << path.size() - 1 << " total steps)" << '\n';
+    if (bound > 0) out << "Suboptimality bound: " << fixed << setprecision(2) << ceil(bound * 100) / 100 << defaultfloat << '\n';
+    for (int i = 0; i < (int)path.size(); ++i) {
+        auto& state = path[i];
+        out << "\n--- Step " << i << " ---" << '\n';
+        print_board(state, out);
+    }
+}
+
+// Compact move list: a slide is the direction the blank moves (U, R, D, L),
+// a pawn move is its destination cell "P<row><col>" or "PX" for the exit,
+// followed by ":<walk cost>". A line reads "<total cost> <moves...>", and an
+// anytime answer ends with " bound:<suboptimality bound>".
+const char SLIDE_NAMES[] = "URDL";
+constexpr uint8_t PAWN_MOVE_FLAG = 0x80;   // binary move byte: pawn move to cell (low bits, NUM_CELLS = exit)
+constexpr int EXIT_CELL = ClassicGeometry::NUM_CELLS;
+
+/// direction (N, E, S, W) in which the blank moved between two adjacent cells
+template <typename Geometry = ClassicGeometry>
+inline int slide_direction(int from, int to) {
+    int dr = to / Geometry::NUM_COLS - from / Geometry::NUM_COLS;
+    return dr < 0 ? 0 : dr > 0 ? 2 : to > from ? 1 : 3;
+}
+
+/// one byte per move: a slide's direction, or PAWN_MOVE_FLAG | destination cell
+template <typename Geometry>
+uint8_t encode_move(const BoardView<Geometry>& from, const BoardView<Geometry>& to) {
+    if (from.blank != to.blank) return slide_direction<Geometry>(from.blank, to.blank);
+    if (to.pawn == Geometry::NUM_NODES) return PAWN_MOVE_FLAG | Geometry::NUM_CELLS;
+    return PAWN_MOVE_FLAG | to.pawn / 2;
+}
+
+uint8_t encode_move(const GameState& from, const GameState& to) {
+    return encode_move(board_view(from), board_view(to));
+}
+
+template <typename Geometry>
+void print_moves(const vector<BoardView<Geometry>>& path, ostream& out, double bound = 0) {
+    out << path.back().cost;
+    for (int i = 1; i < (int)path.size(); ++i) {
+        uint8_t move = encode_move(path[i - 1], path[i]);
+        if (!(move & PAWN_MOVE_FLAG)) {
+            out << ' ' << SLIDE_NAMES[move];
+            continue;
+        }
+        int cell = move & ~PAWN_MOVE_FLAG;
+        out << " P";
+        if (cell == Geometry::NUM_CELLS) out << 'X';
+        else out << cell / Geometry::NUM_COLS << cell % Geometry::NUM_COLS;
+        out << ':' << path[i].cost - path[i - 1].cost;
+    }
+    if (bound > 0) out << " bound:" << fixed << setprecision(2) << ceil(bound * 100) / 100 << defaultfloat;
+    out << '\n';
+}
 
-    while (!(current == initial_state)) {
-        path.push_back(current);
-        auto it = parent_map.find(current.getCompact());
-        if (it == parent_map.end()) {
-            if (!(current == initial_state)) cerr << "Error: Could not reconstruct path fully." << endl;
+// Binary solution record, little endian: uint16 total cost (BINARY_NO_SOLUTION,
+// BINARY_INVALID or BINARY_UNKNOWN instead when there is none), uint16 move count, then one
+// byte per move as from encode_move, a pawn move followed by its walk cost.
+// An anytime answer sets BINARY_HAS_BOUND in the move count and ends with a
+// uint16 suboptimality bound in thousandths, rounded up.
+constexpr uint16_t BINARY_NO_SOLUTION = 0xFFFF;
+constexpr uint16_t BINARY_INVALID = 0xFFFE;
+constexpr uint16_t BINARY_UNKNOWN = 0xFFFD;     // the search stopped at its limit
+constexpr uint16_t BINARY_HAS_BOUND = 0x8000;
+
+void write_binary_record(uint16_t cost, const vector<uint8_t>& moves, uint16_t num_moves, ostream& out) {
+    char header[4] = {(char)(cost & 0xFF), (char)(cost >> 8), (char)(num_moves & 0xFF), (char)(num_moves >> 8)};
+    out.write(header, 4);
+    out.write((const char*)moves.data(), moves.size());
+}
+
+template <typename Geometry>
+void write_binary_moves(const vector<BoardView<Geometry>>& path, ostream& out, double bound = 0) {
+    vector<uint8_t> moves;
+    for (int i = 1; i < (int)path.size(); ++i) {
+        uint8_t move = encode_move(path[i - 1], path[i]);
+        moves.pb(move);
+        if (move & PAWN_MOVE_FLAG) moves.pb(path[i].cost - path[i - 1].cost);
+    }
+    uint16_t num_moves = path.size() - 1;
+    if (bound > 0) {
+        int thousandths = min<double>(ceil(bound * 1000), UINT16_MAX);
+        moves.pb(thousandths & 0xFF);
+        moves.pb(thousandths >> 8);
+        num_moves |= BINARY_HAS_BOUND;
+    }
+    write_binary_record(path.back().cost, moves, num_moves, out);
+}
+
+/// rebuilds a path from its state indices, taking each step's cost from the move generators
+bool rebuild_path(const vector<StateIndex>& indices, const GameState& initial_state, vector<GameState>& path) {
+    path.assign(1, initial_state);
+    SuccessorBuffer successors;
+    for (size_t i = 1; i < indices.size(); ++i) {
+        find_successors(path.back(), successors);
+        bool found = false;
+        for (auto& next : successors) {
+            if (next.getIndex() != indices[i]) continue;
+            path.pb(next);
+            found = true;
             break;
         }
-        current = it->second;
+        if (!found) return false;
+    }
+    return true;
+}
+
+MoveCode arrival_move(const GameState& from, const GameState& to) {
+    if (from.blank_pos == to.blank_pos) return PAWN_ARRIVAL + pawn_slot(from.pawn_pos);
+    return slide_direction(from.blank_pos.first * 3 + from.blank_pos.second, to.blank_pos.first * 3 + to.blank_pos.second);
+}
+
+/// turns a state into its parent, given the move that reached it
+void step_back(GameState& state, MoveCode move) {
+    if (move >= PAWN_ARRIVAL) {
+        int slot = move - PAWN_ARRIVAL;
+        state.pawn_pos = {{slot / 2 / 3, slot / 2 % 3}, slot % 2};
+    } else {
+        auto [r, c] = state.blank_pos;
+        int pr = r - SLIDE_DR[move], pc = c - SLIDE_DC[move];
+        swap(state.board[r][c], state.board[pr][pc]);
+        state.blank_pos = {pr, pc};
     }
-    path.push_back(initial_state);
-    reverse(all(path));
+    state.index_cached = false;
+}
 
-    cout << "--- SOLUTION PATH ---" << endl;
-    cout << "Total Cost: " << end_state.cost_so_far << " (in " << path.size() - 1 << " total steps)" << endl;
-    for (int i = 0; i < path.size(); ++i) {
-        auto& state = path[i];
-        cout << "\n--- Step " << i << " ---" << endl;
-        print_board(state);
+/// steps back along the arrival moves from the goal, then recovers the step costs
+bool reconstruct_path(GameState current, const vector<MoveCode>& arrival, const GameState& initial_state, vector<GameState>& path) {
+    path.assign(1, initial_state);
+    vector<StateIndex> indices{current.getIndex()};
+    while (indices.back() != initial_state.getIndex()) {
+        if (indices.size() > NUM_STATES) return false;
+        step_back(current, arrival[indices.back()]);
+        indices.pb(current.getIndex());
     }
+    reverse(all(indices));
+    return rebuild_path(indices, initial_state, path);
 }
 
-void solve() {
+struct Puzzle {
     GameState initial_state;
-    vector<unique_ptr<Tile>> tile_storage;
-    tile_storage.reserve(10);
+    TileSet tiles;
+};
+
+/// parses one 20-character test case string
+bool parse_puzzle(const string& s, Puzzle& puzzle, ostream& err) {
+    GameState& initial_state = puzzle.initial_state;
+    TileSet& tiles = puzzle.tiles;
 
     // Initialize board
     for (int r = 0; r < 3; ++r) {
         for (int c = 0; c < 3; ++c) {
-            initial_state.board[r][c] = nullptr;
+            initial_state.board[r][c] = NO_TILE;
         }
     }
 
-    string s;
-    cin >> s;
     if (s.size() != 20) {
-        cerr << "Invalid input length. Expected 20 characters." << endl;
-        return;
+        err << "Invalid input length. Expected 20 characters." << endl;
+        return false;
     }
-
-    auto make_tile = [&](char type, int orient) -> Tile* {
-        switch (type) {
-            case 'A': tile_storage.push_back(make_unique<TileA>(orient)); break;
-            case 'B': tile_storage.push_back(make_unique<TileB>(orient)); break;
-            case 'C': tile_storage.push_back(make_unique<TileC>(orient)); break;
-            case 'D': tile_storage.push_back(make_unique<TileD>(orient)); break;
-            case 'E': tile_storage.push_back(make_unique<TileE>(orient)); break;
-            case 'F': tile_storage.push_back(make_unique<TileF>(orient)); break;
-            case 'G': tile_storage.push_back(make_unique<TileG>(orient)); break;
-            case 'H': tile_storage.push_back(make_unique<TileH>(orient)); break;
-            default: return nullptr;
-        }
-        return tile_storage.back().get();
-    };
-
     int idx = 0;
+    unsigned seen_slots = 0;
     for (int r = 0; r < 3; ++r) {
         for (int c = 0; c < 3; ++c) {
             if (idx >= 18) break;
@@ -554,109 +1007,3202 @@ void solve() {
             idx += 2;
 
             if (type == '-' && orient_ch == '-') {
+                if (seen_slots & (1u << BLANK_SLOT)) {
+                    err << "Invalid board: more than one blank tile." << endl;
+                    return false;
+                }
+                seen_slots |= 1u << BLANK_SLOT;
                 initial_state.blank_pos = {r, c};
                 continue;
             }
             int orient = orient_ch - '0';
             if (orient < 0 || orient > 3) {
-                cerr << "Invalid orientation for tile " << type << " at (" << r << "," << c << ")" << endl;
-                return;
+                err << "Invalid orientation for tile " << type << " at (" << r << "," << c << ")" << endl;
+                return false;
             }
 
-            Tile* tile_ptr = make_tile(type, orient);
-            if (tile_ptr) {
-                initial_state.board[r][c] = tile_ptr;
+            // the dense state index needs each of A-H exactly once
+            if (type < 'A' || type > 'H' || (seen_slots & (1u << (type - 'A')))) {
+                err << "Invalid board: tile " << type << " at (" << r << "," << c << ") is unknown or repeated." << endl;
+                return false;
             }
+            seen_slots |= 1u << (type - 'A');
+            initial_state.board[r][c] = tiles[type - 'A'] = make_tile_code(type, orient);
         }
     }
 
     int pawn_r = s[18] - '0';
     int pawn_c = s[19] - '0';
+    if (!is_valid_board_pos(pawn_r, pawn_c)) {
+        err << "Invalid pawn position (" << pawn_r << "," << pawn_c << ")" << endl;
+        return false;
+    }
     initial_state.pawn_pos = {{pawn_r, pawn_c}, 0};
     initial_state.cost_so_far = 0;
     int h = calculate_heuristic(initial_state);
     initial_state.heuristic_cost = initial_state.cost_so_far + h;
-    priority_queue<GameState, vector<GameState>, CompareGameState> pq;
-    unordered_map<CompactState, int, CompactStateHash> min_cost;
-    unordered_map<CompactState, GameState, CompactStateHash> parent_map;
-    /// Most states I got while testing were nearly 6lakhs so reveserving 600000
-    min_cost.reserve(600000);
-    parent_map.reserve(600000);
+    return true;
+}
 
-    pq.push(initial_state);
-    min_cost[initial_state.getCompact()] = 0;
+// Packed binary puzzle: one little-endian uint64 per puzzle. Bits 0-18 hold the
+// permutation rank of the board (tiles A-H and the blank, as in the state
+// index), bits 19-34 the orientation of A-H (2 bits each, A lowest) and bits
+// 35-38 the pawn's cell (row * 3 + column).
+constexpr int PACKED_PUZZLE_BYTES = 8;
 
-    GameState solution_state;
-    bool solution_found = false;
+/// the 20-character test case string of a state; the pawn's floor is dropped
+string puzzle_string(const GameState& state) {
+    string s;
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            TileCode tile = state.board[r][c];
+            if (tile == NO_TILE) {
+                s += "--";
+            } else {
+                s += tile_type(tile);
+                s += char('0' + tile_orientation(tile));
+            }
+        }
+    }
+    s += char('0' + state.pawn_pos.first.first);
+    s += char('0' + state.pawn_pos.first.second);
+    return s;
+}
 
-    int states_explored = 0;
+uint64_t pack_puzzle(const Puzzle& puzzle) {
+    uint64_t packed = permutation_rank(puzzle.initial_state.board);
+    for (int i = 0; i < BLANK_SLOT; ++i) packed |= (uint64_t)tile_orientation(puzzle.tiles[i]) << (19 + 2 * i);
+    auto [r, c] = puzzle.initial_state.pawn_pos.first;
+    return packed | (uint64_t)(r * 3 + c) << 35;
+}
 
-    while (!pq.empty()) {
-        GameState current_state = pq.top();
-        pq.pop();
+/// the 20-character test case string of a packed puzzle; false if out of range
+bool unpack_puzzle(uint64_t packed, string& s) {
+    uint32_t rank = packed & ((1u << 19) - 1);
+    int pawn = packed >> 35 & 0xF;
+    if (rank >= NUM_PERMUTATIONS || pawn >= NUM_CELLS || packed >> 39) return false;
+    TileSet tiles;
+    for (int i = 0; i < BLANK_SLOT; ++i) tiles[i] = make_tile_code('A' + i, packed >> (19 + 2 * i) & 3);
+    s = puzzle_string(decode_state(rank * PAWN_SLOTS + pawn * 2, tiles));
+    return true;
+}
 
-        states_explored++;
+enum class StartFamily {
+    ONE,          // the puzzle as given
+    PAWN_CELLS,   // the pawn on every cell
+    BOARDS,       // and the blank swapped with every cell
+};
 
-        auto compact = current_state.getCompact();
-        if (min_cost.count(compact) && current_state.cost_so_far > min_cost[compact]) {
-            continue;
-        }
+enum class OutputFormat {
+    BOARDS,   // every step as an ASCII board
+    MOVES,    // one compact move list per line
+    BINARY,   // one binary solution record per puzzle
+};
 
-        if (is_goal_state(current_state)) {
-            solution_state = current_state;
-            solution_found = true;
-            break;
-        }
+/// settings of the command line alone: how answers are printed, and the
+/// searches the library does not offer
+struct CommandLineOptions {
+    OutputFormat output_format = OutputFormat::BOARDS;  // --format boards|moves|binary
+    StartFamily start_family = StartFamily::ONE;        // --starts one|pawn|all
+    size_t board_state_limit = 10'000'000;              // --state-limit N: states a --board solver stores (in millions) before it answers unknown
+};
 
-        vector<GameState> pawn_moves = find_pawn_moves(current_state);
-        for (auto& next_state : pawn_moves) {
-            auto next_compact = next_state.getCompact();
-            auto it = min_cost.find(next_compact);
-            if (it == min_cost.end() || next_state.cost_so_far < it->second) {
-                min_cost[next_compact] = next_state.cost_so_far;
-                parent_map[next_compact] = current_state;
-                pq.push(move(next_state));
-            }
-        }
+CommandLineOptions command_line;
 
-        vector<GameState> tile_slides = find_tile_slides(current_state);
-        for (auto& next_state : tile_slides) {
-            auto next_compact = next_state.getCompact();
-            auto it = min_cost.find(next_compact);
-            if (it == min_cost.end() || next_state.cost_so_far < it->second) {
-                min_cost[next_compact] = next_state.cost_so_far;
-                parent_map[next_compact] = current_state;
-                pq.push(move(next_state));
-            }
+/// options of the query running on this thread: a Solver installs its own for
+/// each call with OptionsScope, and main installs the parsed ones for its thread
+const SolverOptions default_options;
+thread_local const SolverOptions* current_options = &default_options;
+
+const SolverOptions& options() { return *current_options; }
+
+class OptionsScope {
+    const SolverOptions* saved;
+
+public:
+    explicit OptionsScope(const SolverOptions& options) : saved(current_options) { current_options = &options; }
+    ~OptionsScope() { current_options = saved; }
+    OptionsScope(const OptionsScope&) = delete;
+    OptionsScope& operator=(const OptionsScope&) = delete;
+};
+
+/// counters of the last search, read by the benchmark
+struct SearchStats {
+    long long expanded = 0;    // states whose successors were generated
+    long long generated = 0;   // successors produced by the move generators
+};
+
+template <typename Geometry>
+void print_solution(const vector<BoardView<Geometry>>& path, ostream& out, double bound = 0) {
+    switch (command_line.output_format) {
+        case OutputFormat::BOARDS: return print_path(path, out, bound);
+        case OutputFormat::MOVES: return print_moves(path, out, bound);
+        case OutputFormat::BINARY: return write_binary_moves(path, out, bound);
+    }
+}
+
+void print_solution(const vector<GameState>& path, ostream& out, double bound = 0) {
+    vector<BoardView<ClassicGeometry>> views;
+    for (auto& state : path) views.pb(board_view(state));
+    print_solution(views, out, bound);
+}
+
+template <typename Geometry>
+void print_no_solution(const BoardView<Geometry>& initial_state, ostream& out) {
+    switch (command_line.output_format) {
+        case OutputFormat::BOARDS:
+            out << "No solution found.\n";
+            out << "\nInitial State:\n";
+            return print_board(initial_state, out);
+        case OutputFormat::MOVES: out << "none\n"; return;
+        case OutputFormat::BINARY: return write_binary_record(BINARY_NO_SOLUTION, {}, 0, out);
+    }
+}
+
+void print_no_solution(const GameState& initial_state, ostream& out) {
+    print_no_solution(board_view(initial_state), out);
+}
+
+/// the search reached its limit without a solution or a proof that none exists
+template <typename Geometry>
+void print_unknown(const BoardView<Geometry>& initial_state, ostream& out) {
+    switch (command_line.output_format) {
+        case OutputFormat::BOARDS:
+            out << "No answer within the search limit.\n";
+            out << "\nInitial State:\n";
+            return print_board(initial_state, out);
+        case OutputFormat::MOVES: out << "unknown\n"; return;
+        case OutputFormat::BINARY: return write_binary_record(BINARY_UNKNOWN, {}, 0, out);
+    }
+}
+
+void print_unknown(const GameState& initial_state, ostream& out) {
+    print_unknown(board_view(initial_state), out);
+}
+
+/// keeps one output record per input puzzle in the compact formats
+void print_invalid(ostream& out) {
+    switch (command_line.output_format) {
+        case OutputFormat::BOARDS: return;
+        case OutputFormat::MOVES: out << "invalid\n"; return;
+        case OutputFormat::BINARY: return write_binary_record(BINARY_INVALID, {}, 0, out);
+    }
+}
+
+/// the moves of a solution path as a library result
+void record_solution(const vector<GameState>& path, SolveResult& result, double bound = 0) {
+    result.status = SolveStatus::SOLVED;
+    result.cost = path.back().cost_so_far - path[0].cost_so_far;
+    result.bound = bound;
+    result.moves.clear();
+    for (size_t i = 1; i < path.size(); ++i) {
+        uint8_t code = encode_move(path[i - 1], path[i]);
+        result.moves.pb({(code & PAWN_MOVE_FLAG) != 0, code & ~PAWN_MOVE_FLAG, path[i].cost_so_far - path[i - 1].cost_so_far});
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Exact distance-to-exit tables
+//
+// For a fixed tile set (the orientations of A-H) one reverse Dijkstra from every
+// goal state labels the whole dense state space with its exact optimal cost.
+// The table keeps one byte per state: the cost modulo 255, or 255 if the exit
+// cannot be reached. Slides are undone by a slide and a pawn walk between two
+// holes by the reverse walk, so from any state with the pawn on a hole every
+// successor's cost lies within the move cost of the current one. Walk costs are
+// far below 255 / 2, hence the residue alone identifies the optimal successors
+// and a query is a greedy walk down the table with no search.
+// ---------------------------------------------------------------------------
+
+constexpr uint8_t DISTANCE_UNREACHABLE = 255;
+constexpr uint16_t DISTANCE_UNSETTLED = UINT16_MAX;
+
+struct DistanceTableHeader {
+    char magic[4];
+    uint32_t version;
+    char orientations[8];   // orientation of tiles A-H
+    uint32_t num_states;
+};
+
+string tile_set_key(const TileSet& tiles) {
+    string key(BLANK_SLOT, '0');
+    for (int i = 0; i < BLANK_SLOT; ++i) key[i] = '0' + tile_orientation(tiles[i]);
+    return key;
+}
+
+string distance_table_path(const TileSet& tiles) {
+    return options().distance_table_dir + "/ttdb_" + tile_set_key(tiles) + ".bin";
+}
+
+/// walk cost from one pawn slot to every pawn slot on a fixed board (-1 if unreachable)
+void pawn_walk_distances(const PawnGraph& graph, int start_slot, int start_cost, int dist[EXIT_PAWN_SLOT]) {
+    fill(dist, dist + EXIT_PAWN_SLOT, -1);
+    flood_pawn_graph(graph, 1u << start_slot, [&](uint32_t layer, int walk_cost) {
+        for (; layer; layer &= layer - 1) dist[__builtin_ctz(layer)] = start_cost + walk_cost;
+    });
+}
+
+/// calls visit(board, pawn_slot, move_cost) for every state with a move into the
+/// given state; an exit state ends the game, so only pawn moves lead into it
+template <typename Visit>
+void for_each_predecessor(const GameState& state, Visit&& visit, const TileTable& table = TILE_TABLE) {
+    int slot = pawn_slot(state.pawn_pos);
+    int br = state.blank_pos.first, bc = state.blank_pos.second;
+
+    // predecessors by slide: the tile now beside the blank came from the blank's cell
+    if (slot != EXIT_PAWN_SLOT && state.pawn_pos.first != state.blank_pos) {
+        for (int i = 0; i < 4; ++i) {
+            int nr = br + SLIDE_DR[i], nc = bc + SLIDE_DC[i];
+            if (!is_valid_board_pos(nr, nc)) continue;
+            BoardConfig board = state.board;
+            swap(board[br][bc], board[nr][nc]);
+            visit(board, slot, 1);
         }
     }
 
-    if (solution_found) {
-        print_path(solution_state, parent_map, initial_state);
-        cerr << "States explored: " << states_explored << endl;
+    // predecessors by pawn move: only holes and the exit end a pawn move
+    int walk[EXIT_PAWN_SLOT];
+    PawnGraph graph = build_pawn_graph(state.board, table);
+    if (slot == EXIT_PAWN_SLOT) {
+        if (!graph.exit_open) return;
+        pawn_walk_distances(graph, 1, 1, walk);
     } else {
-        cout << "No solution found." << endl;
-        cout << "\nInitial State:" << endl;
-        print_board(initial_state);
+        if (!(graph.holes >> slot & 1)) return;
+        pawn_walk_distances(graph, slot, 0, walk);
+    }
+    for (int from = 0; from < EXIT_PAWN_SLOT; from += 2) {
+        if (walk[from] > 0) visit(state.board, from, walk[from]);
     }
 }
 
-int main() {
-    fastio();
-    auto start = high_resolution_clock::now();
+/// same over dense indices: calls visit(predecessor, move_cost)
+template <typename Visit>
+void for_each_predecessor(StateIndex index, const TileSet& tiles, Visit&& visit) {
+    for_each_predecessor(decode_state(index, tiles), [&](const BoardConfig& board, int slot, int step) {
+        visit(permutation_rank(board) * PAWN_SLOTS + slot, step);
+    });
+}
+
+/// reverse Dijkstra from all goal states; dist[i] is the exact cost of state i
+void build_distance_table(const TileSet& tiles, vector<uint16_t>& dist) {
+    dist.assign(NUM_STATES, DISTANCE_UNSETTLED);
+    vector<vector<StateIndex>> buckets(1);
+
+    auto relax = [&](StateIndex index, int cost) {
+        if (cost >= dist[index]) return;
+        dist[index] = cost;
+        if (cost >= (int)buckets.size()) buckets.resize(cost + 1);
+        buckets[cost].pb(index);
+    };
+
+    for (uint32_t p = 0; p < NUM_PERMUTATIONS; ++p) relax(p * PAWN_SLOTS + EXIT_PAWN_SLOT, 0);
+
+    for (size_t d = 0; d < buckets.size(); ++d) {
+        for (size_t k = 0; k < buckets[d].size(); ++k) {
+            StateIndex index = buckets[d][k];
+            if (dist[index] != d) continue;
+            for_each_predecessor(index, tiles, [&](StateIndex pred, int step) { relax(pred, d + step); });
+        }
+        vector<StateIndex>().swap(buckets[d]);
+    }
+}
+
+bool write_distance_table(const TileSet& tiles, const vector<uint16_t>& dist) {
+    string path = distance_table_path(tiles);
+    ofstream out(path, ios::binary);
+    if (!out) return false;
+    DistanceTableHeader header{{'T', 'T', 'D', 'B'}, 1, {}, NUM_STATES};
+    memcpy(header.orientations, tile_set_key(tiles).data(), sizeof(header.orientations));
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    vector<uint8_t> residues(NUM_STATES);
+    for (StateIndex i = 0; i < NUM_STATES; ++i) {
+        residues[i] = dist[i] == DISTANCE_UNSETTLED ? DISTANCE_UNREACHABLE : dist[i] % DISTANCE_UNREACHABLE;
+    }
+    out.write(reinterpret_cast<const char*>(residues.data()), residues.size());
+    return (bool)out;
+}
+
+/// read-only memory-mapped distance table
+class DistanceTable {
+    void* mapping = MAP_FAILED;
+    size_t mapping_size = 0;
+    const uint8_t* residues = nullptr;
+
+public:
+    DistanceTable() = default;
+    DistanceTable(const DistanceTable&) = delete;
+    DistanceTable& operator=(const DistanceTable&) = delete;
+    ~DistanceTable() {
+        if (mapping != MAP_FAILED) munmap(mapping, mapping_size);
+    }
+
+    bool open(const string& path, const string& key) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        size_t expected = sizeof(DistanceTableHeader) + NUM_STATES;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size != expected) {
+            close(fd);
+            return false;
+        }
+        mapping = mmap(nullptr, expected, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) return false;
+        mapping_size = expected;
+        const auto* header = static_cast<const DistanceTableHeader*>(mapping);
+        if (memcmp(header->magic, "TTDB", 4) != 0 || header->version != 1 ||
+            memcmp(header->orientations, key.data(), sizeof(header->orientations)) != 0) {
+            return false;
+        }
+        residues = static_cast<const uint8_t*>(mapping) + sizeof(DistanceTableHeader);
+        return true;
+    }
+
+    uint8_t residue(StateIndex index) const { return residues[index]; }
+};
+
+/// tables stay mapped for the lifetime of the process, keyed by tile set
+DistanceTable* load_distance_table(const TileSet& tiles) {
+    static unordered_map<string, unique_ptr<DistanceTable>> loaded;
+    static mutex loaded_lock;
+    lock_guard<mutex> guard(loaded_lock);
+    string key = tile_set_key(tiles);
+    auto it = loaded.find(key);
+    if (it != loaded.end()) return it->second.get();
+    auto table = make_unique<DistanceTable>();
+    if (!table->open(distance_table_path(tiles), key)) table.reset();
+    return (loaded[key] = move(table)).get();
+}
+
+/// follows optimal successors from a state whose pawn is not on the blank
+bool walk_distance_table(const DistanceTable& table, const GameState& start, vector<GameState>& path, ostream& err) {
+    path.assign(1, start);
+    int residue = table.residue(start.getIndex());
+    if (residue == DISTANCE_UNREACHABLE) return false;
+
+    SuccessorBuffer successors;
+    while (!is_goal_state(path.back())) {
+        int cost = path.back().cost_so_far;
+        find_successors(path.back(), successors);
+        bool advanced = false;
+        for (auto& next : successors) {
+            int next_residue = table.residue(next.getIndex());
+            int step = next.cost_so_far - cost;
+            if (next_residue == DISTANCE_UNREACHABLE || (next_residue + step) % DISTANCE_UNREACHABLE != residue) continue;
+            residue = next_residue;
+            path.pb(next);
+            advanced = true;
+            break;
+        }
+        if (!advanced) {
+            err << "Error: distance table is inconsistent with the move generator." << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/// answers a puzzle from its precomputed table; returns false if no table is available
+bool solve_with_distance_table(const Puzzle& puzzle, SolveResult& result, ostream& err) {
+    const DistanceTable* table = load_distance_table(puzzle.tiles);
+    if (table == nullptr) {
+        err << "No distance table at " << distance_table_path(puzzle.tiles) << ", falling back to search." << endl;
+        return false;
+    }
+
+    const GameState& initial_state = puzzle.initial_state;
+    vector<GameState> path;
+    bool solved;
+    if (initial_state.pawn_pos.first != initial_state.blank_pos) {
+        solved = walk_distance_table(*table, initial_state, path, err);
+    } else {
+        // a pawn standing on the blank cannot be slid back off its tile, so the
+        // residue bound does not hold here: compare the exact costs of each slide
+        solved = false;
+        vector<GameState> candidate;
+        SuccessorBuffer slides;
+        find_tile_slides(initial_state, slides);
+        for (auto& next : slides) {
+            if (!walk_distance_table(*table, next, candidate, err)) continue;
+            if (!solved || candidate.back().cost_so_far < path.back().cost_so_far) {
+                path = candidate;
+                solved = true;
+            }
+        }
+        if (solved) path.insert(path.begin(), initial_state);
+    }
+
+    if (solved) {
+        record_solution(path, result);
+        err << "States explored: 0 (distance table)" << endl;
+    } else {
+        result.status = SolveStatus::NO_SOLUTION;
+    }
+    return true;
+}
+
+/// builds and writes the table for every distinct tile set in the input
+[[maybe_unused]] void build_distance_tables() {
+    int t = 1;
+    cin >> t;
+    unordered_map<string, bool> done;
+    while (t--) {
+        string s;
+        cin >> s;
+        Puzzle puzzle;
+        if (!parse_puzzle(s, puzzle, cerr)) continue;
+        string key = tile_set_key(puzzle.tiles);
+        if (done.count(key)) continue;
+        done[key] = true;
+
+        auto start = high_resolution_clock::now();
+        vector<uint16_t> dist;
+        build_distance_table(puzzle.tiles, dist);
+        size_t solvable = 0;
+        for (uint16_t d : dist) solvable += d != DISTANCE_UNSETTLED;
+        bool written = write_distance_table(puzzle.tiles, dist);
+        auto ms = duration_cast<milliseconds>(high_resolution_clock::now() - start).count();
+        cerr << "Tile set " << key << ": " << solvable << " solvable states, "
+             << (written ? "written to " : "FAILED to write ") << distance_table_path(puzzle.tiles)
+             << " in " << ms << " ms" << endl;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Reachability bitsets
+//
+// Whether the exit can be reached at all is a property of the tile set alone,
+// so one reverse breadth-first pass from every goal state labels the whole dense
+// state space with a single bit: 6,894,720 states in 842 KB. With --use-reach a
+// puzzle whose bit is clear is rejected before any search is started.
+//
+// The same pass groups states into components, counting a move in either
+// direction as a link, and reports how the state space splits up. Every puzzle
+// in the input is then listed with its component, so a puzzle pack can be
+// validated without solving it.
+// ---------------------------------------------------------------------------
+
+constexpr size_t REACH_WORDS = (NUM_STATES + 63) / 64;
+
+string reachability_path(const TileSet& tiles) {
+    return options().distance_table_dir + "/ttreach_" + tile_set_key(tiles) + ".bin";
+}
+
+/// reverse BFS from all goal states; bit i is set if state i can reach the exit
+void build_reachability(const TileSet& tiles, vector<uint64_t>& bits) {
+    bits.assign(REACH_WORDS, 0);
+    vector<StateIndex> frontier, next;
+    auto mark = [&](StateIndex index) {
+        if (bits[index >> 6] >> (index & 63) & 1) return;
+        bits[index >> 6] |= 1ull << (index & 63);
+        next.pb(index);
+    };
+
+    for (uint32_t p = 0; p < NUM_PERMUTATIONS; ++p) mark(p * PAWN_SLOTS + EXIT_PAWN_SLOT);
+    while (!next.empty()) {
+        frontier.swap(next);
+        next.clear();
+        for (StateIndex index : frontier) {
+            for_each_predecessor(index, tiles, [&](StateIndex pred, int) { mark(pred); });
+        }
+    }
+}
+
+bool write_reachability(const TileSet& tiles, const vector<uint64_t>& bits) {
+    ofstream out(reachability_path(tiles), ios::binary);
+    if (!out) return false;
+    DistanceTableHeader header{{'T', 'T', 'R', 'B'}, 1, {}, NUM_STATES};
+    memcpy(header.orientations, tile_set_key(tiles).data(), sizeof(header.orientations));
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(bits.data()), bits.size() * sizeof(uint64_t));
+    return (bool)out;
+}
+
+/// read-only memory-mapped reachability bitset
+class ReachabilityTable {
+    void* mapping = MAP_FAILED;
+    size_t mapping_size = 0;
+    const uint64_t* bits = nullptr;
+
+public:
+    ReachabilityTable() = default;
+    ReachabilityTable(const ReachabilityTable&) = delete;
+    ReachabilityTable& operator=(const ReachabilityTable&) = delete;
+    ~ReachabilityTable() {
+        if (mapping != MAP_FAILED) munmap(mapping, mapping_size);
+    }
+
+    bool open(const string& path, const string& key) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        size_t expected = sizeof(DistanceTableHeader) + REACH_WORDS * sizeof(uint64_t);
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size != expected) {
+            close(fd);
+            return false;
+        }
+        mapping = mmap(nullptr, expected, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) return false;
+        mapping_size = expected;
+        const auto* header = static_cast<const DistanceTableHeader*>(mapping);
+        if (memcmp(header->magic, "TTRB", 4) != 0 || header->version != 1 ||
+            memcmp(header->orientations, key.data(), sizeof(header->orientations)) != 0) {
+            return false;
+        }
+        bits = reinterpret_cast<const uint64_t*>(static_cast<const char*>(mapping) + sizeof(DistanceTableHeader));
+        return true;
+    }
+
+    bool reachable(StateIndex index) const { return bits[index >> 6] >> (index & 63) & 1; }
+};
+
+ReachabilityTable* load_reachability(const TileSet& tiles) {
+    static unordered_map<string, unique_ptr<ReachabilityTable>> loaded;
+    static mutex loaded_lock;
+    lock_guard<mutex> guard(loaded_lock);
+    string key = tile_set_key(tiles);
+    auto it = loaded.find(key);
+    if (it != loaded.end()) return it->second.get();
+    auto table = make_unique<ReachabilityTable>();
+    if (!table->open(reachability_path(tiles), key)) table.reset();
+    return (loaded[key] = move(table)).get();
+}
+
+/// true if the start can reach the exit; a pawn on the blank is judged by the
+/// slides that lift it onto a tile, as in solve_with_distance_table
+template <typename Reachable>
+bool start_reaches_exit(const GameState& initial_state, Reachable&& reachable) {
+    if (initial_state.pawn_pos.first != initial_state.blank_pos) return reachable(initial_state.getIndex());
+    SuccessorBuffer slides;
+    find_tile_slides(initial_state, slides);
+    for (auto& next : slides) {
+        if (reachable(next.getIndex())) return true;
+    }
+    return false;
+}
+
+/// O(1) rejection of an unsolvable puzzle; returns false if the search should go on
+bool reject_unreachable(const Puzzle& puzzle, SolveResult& result, ostream& err) {
+    const ReachabilityTable* table = load_reachability(puzzle.tiles);
+    if (table == nullptr) {
+        err << "No reachability table at " << reachability_path(puzzle.tiles) << ", searching." << endl;
+        return false;
+    }
+    if (start_reaches_exit(puzzle.initial_state, [&](StateIndex index) { return table->reachable(index); })) return false;
+    result.status = SolveStatus::NO_SOLUTION;
+    err << "States explored: 0 (reachability table)" << endl;
+    return true;
+}
+
+/// components of the state graph linked by the moves that can be undone: a
+/// slide, and a walk from one hole to another. Any state of a component can
+/// reach any other, so a component is solvable or unsolvable as a whole. Exit
+/// states, and starts whose only moves are one-way (a pawn on the blank or off
+/// a hole), stay outside the components they lead into.
+struct StateComponents {
+    vector<uint32_t> parent;   // union-find forest over state indices
+    vector<uint32_t> size;     // states per component, valid at roots; 0 for exit states
+    vector<uint64_t> bits;     // the reachability bitset the components were built with
+
+    uint32_t find(uint32_t x) {
+        while (parent[x] != x) x = parent[x] = parent[parent[x]];
+        return x;
+    }
+
+    bool solvable(uint32_t root) const { return bits[root >> 6] >> (root & 63) & 1; }
+
+    void build(const TileSet& tiles, const vector<uint64_t>& reachable) {
+        bits = reachable;
+        parent.resize(NUM_STATES);
+        iota(all(parent), 0u);
+        for (StateIndex index = 0; index < NUM_STATES; ++index) {
+            if (index % PAWN_SLOTS == EXIT_PAWN_SLOT) continue;
+            GameState state = decode_state(index, tiles);
+            uint32_t holes = build_pawn_graph(state.board).holes;
+            for_each_predecessor(state, [&](const BoardConfig& board, int slot, int) {
+                // a walk keeps the board and is undone from a hole only; a
+                // slide is undone unless it lifted the pawn off the blank
+                bool walk = board == state.board;
+                if (walk ? !(holes >> slot & 1) : board[slot / 2 / 3][slot / 2 % 3] == NO_TILE) return;
+                uint32_t a = find(index), b = find(permutation_rank(board) * PAWN_SLOTS + slot);
+                if (a != b) parent[max(a, b)] = min(a, b);
+            });
+        }
+        // roots are the smallest index of their component, a stable identifier
+        size.assign(NUM_STATES, 0);
+        for (StateIndex index = 0; index < NUM_STATES; ++index) {
+            if (index % PAWN_SLOTS != EXIT_PAWN_SLOT) ++size[find(index)];
+        }
+    }
+};
+
+/// builds and writes the bitset for every distinct tile set in the input and
+/// lists each puzzle's component on stdout
+[[maybe_unused]] void build_reachability_tables() {
+    int t = 1;
+    cin >> t;
+    vector<string> cases(max(t, 0));
+    for (auto& s : cases) cin >> s;
+
+    // one pass per tile set, in order of first appearance
+    vector<string> keys;
+    unordered_map<string, vector<int>> by_tile_set;
+    vector<Puzzle> puzzles(cases.size());
+    vector<string> verdicts(cases.size(), "invalid");
+    for (int i = 0; i < (int)cases.size(); ++i) {
+        if (!parse_puzzle(cases[i], puzzles[i], cerr)) continue;
+        string key = tile_set_key(puzzles[i].tiles);
+        if (!by_tile_set.count(key)) keys.pb(key);
+        by_tile_set[key].pb(i);
+    }
+
+    for (const string& key : keys) {
+        const TileSet& tiles = puzzles[by_tile_set[key][0]].tiles;
+        auto start = high_resolution_clock::now();
+        vector<uint64_t> bits;
+        build_reachability(tiles, bits);
+        bool written = write_reachability(tiles, bits);
+        StateComponents components;
+        components.build(tiles, bits);
+
+        size_t solvable = 0, count = 0, with_exit = 0, singletons = 0, largest = 0, largest_dead = 0;
+        for (StateIndex root = 0; root < NUM_STATES; ++root) {
+            if (components.size[root] == 0 || components.find(root) != root) continue;
+            ++count;
+            if (components.solvable(root)) solvable += components.size[root];
+            with_exit += components.solvable(root);
+            singletons += components.size[root] == 1;
+            largest = max<size_t>(largest, components.size[root]);
+            if (!components.solvable(root)) largest_dead = max<size_t>(largest_dead, components.size[root]);
+        }
+        auto ms = duration_cast<milliseconds>(high_resolution_clock::now() - start).count();
+        cerr << "Tile set " << key << ": " << solvable << " of " << NUM_STATES - NUM_PERMUTATIONS << " board states solvable, "
+             << count << " components (" << with_exit << " reaching the exit, " << singletons
+             << " single states, largest " << largest << ", largest without exit " << largest_dead << "), "
+             << (written ? "written to " : "FAILED to write ") << reachability_path(tiles)
+             << " in " << ms << " ms" << endl;
+
+        for (int i : by_tile_set[key]) {
+            const GameState& initial_state = puzzles[i].initial_state;
+            bool reachable = start_reaches_exit(initial_state, [&](StateIndex index) {
+                return bits[index >> 6] >> (index & 63) & 1;
+            });
+            uint32_t root = components.find(initial_state.getIndex());
+            verdicts[i] = string(reachable ? "solvable" : "unsolvable") + ", tile set " + key + ", component " +
+                          to_string(root) + " (" + to_string(components.size[root]) + " states, " +
+                          (components.solvable(root) ? "solvable" : "unsolvable") + ")";
+        }
+    }
+
+    for (int i = 0; i < (int)cases.size(); ++i) cout << "Case " << i + 1 << ": " << verdicts[i] << "\n";
+}
+
+// ---------------------------------------------------------------------------
+// Perimeter search
+//
+// A reverse Dijkstra from every goal state, stopped at cost R, stores the exact
+// cost of each state inside that radius in an open-addressing hash table. The
+// forward A* uses the exact cost inside the perimeter and R + 1 as a lower
+// bound outside it (every path to the exit crosses the perimeter), and stops as
+// soon as it pops a perimeter state: the rest of the path is a walk down the
+// stored costs.
+// ---------------------------------------------------------------------------
+
+class PerimeterTable {
+    static constexpr StateIndex EMPTY = UINT32_MAX;
+    vector<StateIndex> keys;
+    vector<uint8_t> costs;
+    size_t count = 0;
+    int radius;
+
+    size_t slot_of(StateIndex index) const {
+        return (size_t)(index * 0x9E3779B97F4A7C15ull >> 20) & (keys.size() - 1);
+    }
+
+    void grow() {
+        vector<StateIndex> old_keys(keys.size() * 2, EMPTY);
+        vector<uint8_t> old_costs(costs.size() * 2);
+        old_keys.swap(keys);
+        old_costs.swap(costs);
+        for (size_t i = 0; i < old_keys.size(); ++i) {
+            if (old_keys[i] == EMPTY) continue;
+            size_t slot = slot_of(old_keys[i]);
+            while (keys[slot] != EMPTY) slot = (slot + 1) & (keys.size() - 1);
+            keys[slot] = old_keys[i];
+            costs[slot] = old_costs[i];
+        }
+    }
+
+public:
+    explicit PerimeterTable(int radius) : keys(1 << 16, EMPTY), costs(1 << 16), radius(radius) {}
+
+    int getRadius() const { return radius; }
+    size_t size() const { return count; }
+
+    /// exact cost to the exit, or -1 if the state lies outside the perimeter
+    int lookup(StateIndex index) const {
+        if (index % PAWN_SLOTS == EXIT_PAWN_SLOT) return 0;
+        for (size_t slot = slot_of(index);; slot = (slot + 1) & (keys.size() - 1)) {
+            if (keys[slot] == index) return costs[slot];
+            if (keys[slot] == EMPTY) return -1;
+        }
+    }
+
+    /// inserts or lowers the cost of a state; returns true if it changed
+    bool lower(StateIndex index, int cost) {
+        if (2 * (count + 1) > keys.size()) grow();
+        size_t slot = slot_of(index);
+        while (keys[slot] != EMPTY && keys[slot] != index) slot = (slot + 1) & (keys.size() - 1);
+        if (keys[slot] == index) {
+            if (costs[slot] <= cost) return false;
+        } else {
+            keys[slot] = index;
+            count++;
+        }
+        costs[slot] = cost;
+        return true;
+    }
+
+    /// admissible estimate combining the perimeter with the hand-written heuristic
+    int heuristic(StateIndex index, int fallback) const {
+        int cost = lookup(index);
+        return cost >= 0 ? cost : max(fallback, radius + 1);
+    }
+};
+
+/// reverse Dijkstra from all goal states out to the table's radius
+void build_perimeter(const TileSet& tiles, PerimeterTable& perimeter) {
+    int radius = perimeter.getRadius();
+    vector<vector<StateIndex>> buckets(radius + 1);
+    // goal states are recognised by their pawn slot and never stored
+    for (uint32_t p = 0; p < NUM_PERMUTATIONS; ++p) buckets[0].pb(p * PAWN_SLOTS + EXIT_PAWN_SLOT);
+
+    for (int d = 0; d <= radius; ++d) {
+        for (size_t k = 0; k < buckets[d].size(); ++k) {
+            StateIndex index = buckets[d][k];
+            if (perimeter.lookup(index) != d) continue;
+            for_each_predecessor(index, tiles, [&](StateIndex pred, int step) {
+                if (d + step <= radius && perimeter.lower(pred, d + step)) buckets[d + step].pb(pred);
+            });
+        }
+        vector<StateIndex>().swap(buckets[d]);
+    }
+}
+
+/// appends the optimal continuation from a perimeter state to the exit
+bool descend_perimeter(const PerimeterTable& perimeter, vector<GameState>& path) {
+    SuccessorBuffer successors;
+    while (!is_goal_state(path.back())) {
+        int cost = perimeter.lookup(path.back().getIndex()), g = path.back().cost_so_far;
+        find_successors(path.back(), successors);
+        bool advanced = false;
+        for (auto& next : successors) {
+            int next_cost = perimeter.lookup(next.getIndex());
+            if (next_cost < 0 || next_cost + next.cost_so_far - g != cost) continue;
+            path.pb(next);
+            advanced = true;
+            break;
+        }
+        if (!advanced) return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Pattern databases
+//
+// An abstraction keeps the pawn, the blank and a chosen subset of tiles; every
+// other tile becomes WILDCARD_TILE, whose openings, hole and stairs are the
+// union of the tiles it hides. A wildcard allows every move a hidden tile
+// would, so the abstract cost never exceeds the real one. One reverse Dijkstra
+// over the abstract space stores the cost of every abstract state in a byte.
+// Abstractions share the pawn and blank moves, so several databases are
+// combined by max, not added. --build-pdb writes the databases of each tile set
+// in the input next to the distance tables (ttpdb_<tile set>_<letters>.bin),
+// and a database on disk is read instead of built.
+// ---------------------------------------------------------------------------
+
+string pattern_database_path(const TileSet& tiles, const string& letters) {
+    return options().distance_table_dir + "/ttpdb_" + tile_set_key(tiles) + "_" + letters + ".bin";
+}
+
+class PatternDatabase {
+    static constexpr uint8_t UNREACHABLE = 255;
+    array<int8_t, BLANK_SLOT> pattern_index;   // position of each tile slot in the pattern, -1 if abstracted
+    vector<int> pattern_slots;                 // kept tile slots followed by BLANK_SLOT
+    vector<uint8_t> costs;
+    uint32_t num_placements = 1;
+    TileTable table = TILE_TABLE;
+
+    /// ranks the cells holding the kept tiles and the blank, in pattern order
+    uint32_t placement_rank(const BoardConfig& board) const {
+        int cells[NUM_CELLS];
+        for (int i = 0; i < NUM_CELLS; ++i) {
+            TileCode code = board[i / 3][i % 3];
+            if (code == NO_TILE) cells[pattern_slots.size() - 1] = i;
+            else if (code != WILDCARD_TILE && pattern_index[tile_slot(code)] >= 0) cells[pattern_index[tile_slot(code)]] = i;
+        }
+        return rank_cells(cells);
+    }
+
+    uint32_t placement_rank(PackedState state) const {
+        int cells[NUM_CELLS];
+        for (int i = 0; i < NUM_CELLS; ++i) {
+            int slot = packed_slot(state, i);
+            if (slot == BLANK_SLOT) cells[pattern_slots.size() - 1] = i;
+            else if (pattern_index[slot] >= 0) cells[pattern_index[slot]] = i;
+        }
+        return rank_cells(cells);
+    }
+
+    uint32_t rank_cells(const int cells[NUM_CELLS]) const {
+        uint32_t rank = 0;
+        unsigned used = 0;
+        for (size_t k = 0; k < pattern_slots.size(); ++k) {
+            rank = rank * (NUM_CELLS - k) + cells[k] - __builtin_popcount(used & ((1u << cells[k]) - 1));
+            used |= 1u << cells[k];
+        }
+        return rank;
+    }
+
+    GameState decode(uint32_t index, const TileSet& tiles) const {
+        GameState state;
+        for (auto& row : state.board) row.fill(WILDCARD_TILE);
+        uint32_t rank = index / PAWN_SLOTS;
+        unsigned available = (1u << NUM_CELLS) - 1;
+        int n = pattern_slots.size();
+        int offsets[NUM_CELLS];
+        for (int k = n - 1; k >= 0; --k) {
+            offsets[k] = rank % (NUM_CELLS - k);
+            rank /= NUM_CELLS - k;
+        }
+        for (int k = 0; k < n; ++k) {
+            unsigned bits = available;
+            for (int skip = offsets[k]; skip--;) bits &= bits - 1;
+            int cell = __builtin_ctz(bits);
+            available &= ~(1u << cell);
+            if (pattern_slots[k] == BLANK_SLOT) {
+                state.board[cell / 3][cell % 3] = NO_TILE;
+                state.blank_pos = {cell / 3, cell % 3};
+            } else {
+                state.board[cell / 3][cell % 3] = tiles[pattern_slots[k]];
+            }
+        }
+        int pawn = index % PAWN_SLOTS;
+        if (pawn == EXIT_PAWN_SLOT) state.pawn_pos = {{0, -1}, 1};
+        else state.pawn_pos = {{pawn / 2 / 3, pawn / 2 % 3}, pawn % 2};
+        return state;
+    }
+
+public:
+    /// letters of the tiles to keep, e.g. "ACDE"
+    explicit PatternDatabase(const string& letters) {
+        pattern_index.fill(-1);
+        for (char letter : letters) {
+            int slot = letter - 'A';
+            if (slot < 0 || slot >= BLANK_SLOT || pattern_index[slot] >= 0) continue;
+            pattern_index[slot] = pattern_slots.size();
+            pattern_slots.pb(slot);
+        }
+        pattern_slots.pb(BLANK_SLOT);
+        for (size_t k = 0; k < pattern_slots.size(); ++k) num_placements *= NUM_CELLS - k;
+    }
+
+    size_t size() const { return costs.size(); }
+
+    bool write(const string& path, const TileSet& tiles) const {
+        ofstream out(path, ios::binary);
+        if (!out) return false;
+        DistanceTableHeader header{{'T', 'T', 'P', 'D'}, 1, {}, (uint32_t)costs.size()};
+        memcpy(header.orientations, tile_set_key(tiles).data(), sizeof(header.orientations));
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(costs.data()), costs.size());
+        return (bool)out;
+    }
+
+    /// loads the costs --build-pdb wrote for this pattern and tile set; false
+    /// if there is no such file
+    bool read(const string& path, const TileSet& tiles) {
+        ifstream in(path, ios::binary);
+        DistanceTableHeader header;
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+        if (memcmp(header.magic, "TTPD", 4) != 0 || header.version != 1 ||
+            memcmp(header.orientations, tile_set_key(tiles).data(), sizeof(header.orientations)) != 0 ||
+            header.num_states != num_placements * PAWN_SLOTS) {
+            return false;
+        }
+        costs.resize(header.num_states);
+        if (!in.read(reinterpret_cast<char*>(costs.data()), costs.size())) {
+            costs.clear();
+            return false;
+        }
+        return true;
+    }
+
+    void build(const TileSet& tiles) {
+        TileInfo wildcard = {0, 0, false, -1};
+        for (int slot = 0; slot < BLANK_SLOT; ++slot) {
+            if (pattern_index[slot] >= 0) continue;
+            const TileInfo& hidden = tile_info(tiles[slot]);
+            wildcard.top_mask |= hidden.top_mask;
+            wildcard.ground_mask |= hidden.ground_mask;
+            wildcard.hole |= hidden.hole;
+            if (hidden.stairs != -1) wildcard.stairs = hidden.stairs;
+        }
+        table[WILDCARD_TILE] = wildcard;
+
+        uint32_t num_states = num_placements * PAWN_SLOTS;
+        costs.assign(num_states, UNREACHABLE);
+        vector<vector<uint32_t>> buckets(1);
+        auto relax = [&](uint32_t index, int cost) {
+            cost = min(cost, UNREACHABLE - 1);
+            if (cost >= costs[index]) return;
+            costs[index] = cost;
+            if (cost >= (int)buckets.size()) buckets.resize(cost + 1);
+            buckets[cost].pb(index);
+        };
+        for (uint32_t p = 0; p < num_placements; ++p) relax(p * PAWN_SLOTS + EXIT_PAWN_SLOT, 0);
+
+        for (size_t d = 0; d < buckets.size(); ++d) {
+            for (size_t k = 0; k < buckets[d].size(); ++k) {
+                uint32_t index = buckets[d][k];
+                if (costs[index] != d) continue;
+                for_each_predecessor(decode(index, tiles), [&](const BoardConfig& board, int slot, int step) {
+                    relax(placement_rank(board) * PAWN_SLOTS + slot, d + step);
+                }, table);
+            }
+            vector<uint32_t>().swap(buckets[d]);
+        }
+    }
+
+    /// lower bound on the cost to the exit, or -1 if the exit is unreachable
+    int lookup(const GameState& state) const {
+        uint8_t cost = costs[placement_rank(state.board) * PAWN_SLOTS + pawn_slot(state.pawn_pos)];
+        return cost == UNREACHABLE ? -1 : cost;
+    }
+
+    int lookup(PackedState state) const {
+        uint8_t cost = costs[placement_rank(state) * PAWN_SLOTS + packed_pawn(state)];
+        return cost == UNREACHABLE ? -1 : cost;
+    }
+};
+
+/// "ABCD,EFGH" -> one database per comma-separated group
+vector<PatternDatabase> make_pattern_databases(const string& spec, const TileSet& tiles) {
+    vector<PatternDatabase> databases;
+    stringstream groups(spec);
+    string letters;
+    while (getline(groups, letters, ',')) {
+        if (letters.empty()) continue;
+        databases.emplace_back(letters);
+        if (!databases.back().read(pattern_database_path(tiles, letters), tiles)) databases.back().build(tiles);
+    }
+    return databases;
+}
+
+/// true if every database of the spec is on disk for the tile set
+bool pattern_databases_on_disk(const string& spec, const TileSet& tiles) {
+    stringstream groups(spec);
+    string letters;
+    struct stat st;
+    while (getline(groups, letters, ',')) {
+        if (!letters.empty() && stat(pattern_database_path(tiles, letters).c_str(), &st) != 0) return false;
+    }
+    return true;
+}
+
+/// builds and writes the databases of the spec for every distinct tile set in the input
+[[maybe_unused]] void build_pattern_database_files(const string& spec) {
+    int t = 1;
+    cin >> t;
+    unordered_map<string, bool> done;
+    while (t--) {
+        string s;
+        cin >> s;
+        Puzzle puzzle;
+        if (!parse_puzzle(s, puzzle, cerr)) continue;
+        string key = tile_set_key(puzzle.tiles);
+        if (done.count(key)) continue;
+        done[key] = true;
+
+        stringstream groups(spec);
+        string letters;
+        while (getline(groups, letters, ',')) {
+            if (letters.empty()) continue;
+            auto start = high_resolution_clock::now();
+            PatternDatabase database(letters);
+            database.build(puzzle.tiles);
+            string path = pattern_database_path(puzzle.tiles, letters);
+            bool written = database.write(path, puzzle.tiles);
+            auto ms = duration_cast<milliseconds>(high_resolution_clock::now() - start).count();
+            cerr << "Tile set " << key << ", pattern " << letters << ": " << database.size() << " entries, "
+                 << (written ? "written to " : "FAILED to write ") << path << " in " << ms << " ms" << endl;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Hash-distributed parallel A* (HDA*)
+//
+// Every state is owned by one thread, chosen by a hash of its index. A thread
+// keeps the open list for the states it owns and is the only writer of their
+// entries in the shared g / parent tables. Successors owned by another thread
+// are batched and pushed onto the owner's lock-free inbox.
+//
+// Termination: `work` counts running threads plus batches in flight. A sender
+// is running while it pushes, and an idle receiver counts itself running again
+// before it consumes a batch, so work reaches zero only once no thread can
+// create new work. Threads stop expanding at f >= incumbent, so when work is
+// zero every state with f below the incumbent has been expanded and the
+// incumbent is optimal.
+// ---------------------------------------------------------------------------
+
+struct SearchMessage {
+    StateIndex index;
+    int f, g;
+    MoveCode arrival;
+};
+
+struct MessageBatch {
+    MessageBatch* next;
+    vector<SearchMessage> messages;
+};
+
+/// multi-producer single-consumer inbox: a Treiber stack drained all at once
+class Inbox {
+    atomic<MessageBatch*> head{nullptr};
+
+public:
+    void push(MessageBatch* batch) {
+        batch->next = head.load(memory_order_relaxed);
+        while (!head.compare_exchange_weak(batch->next, batch, memory_order_release, memory_order_relaxed)) {}
+    }
+    MessageBatch* take_all() { return head.exchange(nullptr, memory_order_acquire); }
+    bool empty() const { return head.load(memory_order_relaxed) == nullptr; }
+};
+
+inline int state_owner(StateIndex index, int num_threads) {
+    uint32_t h = index * 0x9E3779B1u;
+    return ((uint64_t)h * num_threads) >> 32;
+}
+
+/// optimal search of one puzzle split over num_threads threads
+/// g_table, arrival and opens are the caller's scratch, reused across puzzles;
+/// every state is read and written only by its owner thread
+void solve_parallel(const Puzzle& puzzle, int num_threads, EpochCostTable& g_table, vector<MoveCode>& arrival,
+                    vector<BucketQueue>& opens, SearchStats& stats, SolveResult& result, ostream& err) {
+    constexpr size_t BATCH_SIZE = 64;
+    constexpr StateIndex NO_GOAL = UINT32_MAX;
+    const GameState& initial_state = puzzle.initial_state;
+    const TileSet& tiles = puzzle.tiles;
+
+    vector<Inbox> inboxes(num_threads);
+    opens.resize(num_threads);
+    atomic<long long> work{num_threads};
+    atomic<long long> states_explored{0}, states_generated{0};
+    atomic<int> incumbent{INT_MAX};
+    atomic<StateIndex> goal_index{NO_GOAL};
+    mutex goal_lock;
+    STATS(search_counters.engine = "hda"; SearchCounters* caller_counters = &search_counters; mutex counters_lock;)
+
+    StateIndex start = initial_state.getIndex();
+    g_table.set(start, 0);
+    STATS(search_counters.min_cost_entries++);
+    arrival[start] = NO_ARRIVAL;
+    opens[state_owner(start, num_threads)].push(start, initial_state.heuristic_cost, 0);
+
+    auto search = [&](int self) {
+        BucketQueue& open = opens[self];
+        SuccessorBuffer successors;
+        vector<MessageBatch*> outgoing(num_threads, nullptr);
+        long long expanded = 0, generated = 0;
+
+        auto relax = [&](const SearchMessage& message) {
+            int known = g_table.get(message.index);
+            if (message.g >= known) return;
+            STATS(search_counters.inserted++);
+            STATS(search_counters.min_cost_entries += known == INT_MAX);
+            g_table.set(message.index, message.g);
+            arrival[message.index] = message.arrival;
+            if (message.index % PAWN_SLOTS == EXIT_PAWN_SLOT) {
+                lock_guard<mutex> guard(goal_lock);
+                if (message.g < incumbent.load()) {
+                    incumbent.store(message.g);
+                    goal_index.store(message.index);
+                }
+                return;
+            }
+            if (message.f < incumbent.load(memory_order_relaxed)) open.push(message.index, message.f, message.g);
+            STATS(search_counters.open_high_water = max<long long>(search_counters.open_high_water, open.size()));
+        };
+        auto flush = [&](int owner) {
+            if (outgoing[owner] == nullptr) return;
+            work.fetch_add(1);
+            inboxes[owner].push(outgoing[owner]);
+            outgoing[owner] = nullptr;
+        };
+        auto send = [&](const SearchMessage& message) {
+            int owner = state_owner(message.index, num_threads);
+            if (owner == self) return relax(message);
+            if (outgoing[owner] == nullptr) outgoing[owner] = new MessageBatch{nullptr, {}};
+            outgoing[owner]->messages.pb(message);
+            if (outgoing[owner]->messages.size() >= BATCH_SIZE) flush(owner);
+        };
+        // consumes every waiting batch; the caller must be counted as running
+        auto drain = [&]() {
+            long long batches = 0;
+            for (MessageBatch* batch = inboxes[self].take_all(); batch != nullptr; ++batches) {
+                for (auto& message : batch->messages) relax(message);
+                MessageBatch* next = batch->next;
+                delete batch;
+                batch = next;
+            }
+            if (batches) work.fetch_sub(batches);
+        };
+
+        while (true) {
+            drain();
+            if (!open.empty() && open.top_f() < incumbent.load(memory_order_relaxed)) {
+                int f, g;
+                StateIndex index;
+                {
+                    STATS_TIMER(pop_ns);
+                    index = open.pop(f, g);
+                }
+                if (g > g_table.get(index)) {
+                    STATS(search_counters.stale_pops++);
+                    continue;
+                }
+                expanded++;
+
+                GameState current_state = decode_state(index, tiles);
+                current_state.cost_so_far = g;
+                current_state.heuristic_cost = f;
+                {
+                    STATS_TIMER(generate_ns);
+                    find_successors(current_state, successors, arrival[index]);
+                }
+                generated += successors.count;
+                for (auto& next_state : successors) {
+                    send({next_state.getIndex(), next_state.heuristic_cost, next_state.cost_so_far,
+                          arrival_move(current_state, next_state)});
+                }
+                continue;
+            }
+
+            // nothing worth expanding: hand off buffered successors and go idle
+            for (int owner = 0; owner < num_threads; ++owner) flush(owner);
+            open.clear();
+            work.fetch_sub(1);
+            while (inboxes[self].empty() && work.load() != 0) this_thread::yield();
+            if (inboxes[self].empty()) break;
+            work.fetch_add(1);
+        }
+        states_explored += expanded;
+        states_generated += generated;
+        STATS(lock_guard<mutex> guard(counters_lock); caller_counters->add(search_counters));
+    };
+
+    vector<thread> threads;
+    for (int t = 0; t < num_threads; ++t) threads.emplace_back(search, t);
+    for (auto& thread : threads) thread.join();
+    stats = {states_explored.load(), states_generated.load()};
+
+    if (goal_index.load() == NO_GOAL) {
+        result.status = SolveStatus::NO_SOLUTION;
+        return;
+    }
+    vector<GameState> path;
+    if (!reconstruct_path(decode_state(goal_index.load(), tiles), arrival, initial_state, path)) err << "Error: Could not reconstruct path fully." << endl;
+    record_solution(path, result);
+    err << "States explored: " << states_explored.load() << " (" << num_threads << " search threads)" << endl;
+}
+
+// ---------------------------------------------------------------------------
+// Low-memory IDA*
+//
+// Depth-first iterations with an increasing f threshold over a single state
+// that is changed and restored in place, so the search itself only keeps the
+// current path. A fixed-size transposition table remembers the smallest g at
+// which each state was expanded in the current iteration; a state reached
+// again with no smaller g has nothing new to offer and is cut. Losing an entry
+// only costs repeated work, so optimality never depends on the table's size.
+//
+// States cut by the threshold are remembered too. If an iteration ends with no
+// entry of its own evicted and every state it touched expanded, it has walked
+// the whole component of the start without meeting the exit: unsolvable.
+// When the component does not fit in the table, evictions let paths revisit
+// states and the iterations never run out of cut states, so IDA* alone would
+// not stop on such a board. It stops once it has visited SolverOptions::ida_work_limit
+// states and the puzzle is answered unknown; memory never grows past the
+// table. By default the limit is IDA_WORK_PER_ENTRY visits per table entry: a
+// component that fits is proved unsolvable well within it, and a failed query
+// costs a couple of seconds with the default table. The hardest benchmark
+// boards need more (up to 74 M states with pattern databases, 260 M without),
+// so they want a larger table or an explicit limit.
+// ---------------------------------------------------------------------------
+
+constexpr long long IDA_WORK_PER_ENTRY = 16;
+
+class TranspositionTable {
+    struct Entry {
+        StateIndex key;
+        uint16_t g : 15;
+        uint16_t expanded : 1;
+        uint16_t iteration;
+    };
+    static constexpr int WAYS = 4;
+    vector<Entry> entries;
+    size_t bucket_mask = 0;
+
+public:
+    /// rounds the table down to a power-of-two number of 4-way buckets
+    void resize(size_t bytes) {
+        size_t buckets = 1;
+        while (buckets * 2 * WAYS * sizeof(Entry) <= bytes) buckets *= 2;
+        if (entries.size() == buckets * WAYS) return;
+        entries.assign(buckets * WAYS, {UINT32_MAX, 0, 0, 0});
+        bucket_mask = buckets - 1;
+    }
+
+    size_t bytes() const { return entries.size() * sizeof(Entry); }
+    size_t capacity() const { return entries.size(); }
+
+    void clear() { fill(all(entries), Entry{UINT32_MAX, 0, 0, 0}); }
+
+    /// set when a store pushed out an entry of the current iteration
+    bool overflowed = false;
+
+    /// true if the state was already expanded in this iteration with g no larger
+    bool seen(StateIndex key, int g, uint16_t iteration) const {
+        const Entry* bucket = &entries[(key * 0x9E3779B1u >> 8 & bucket_mask) * WAYS];
+        for (int w = 0; w < WAYS; ++w) {
+            if (bucket[w].key == key) {
+                return bucket[w].iteration == iteration && bucket[w].expanded && bucket[w].g <= g;
+            }
+        }
+        return false;
+    }
+
+    /// replacement: the same key, else an entry from an older iteration, else a
+    /// state cut by the threshold, else the deepest entry (largest g), whose
+    /// subtree is cheapest to redo
+    void store(StateIndex key, int g, bool expanded, uint16_t iteration) {
+        Entry* bucket = &entries[(key * 0x9E3779B1u >> 8 & bucket_mask) * WAYS];
+        auto rank = [&](const Entry& entry) { return entry.iteration != iteration ? 2 : !entry.expanded; };
+        Entry* victim = &bucket[0];
+        for (int w = 0; w < WAYS; ++w) {
+            Entry& entry = bucket[w];
+            if (entry.key == key) {
+                if (entry.iteration == iteration && entry.g <= g) return;
+                victim = &entry;
+                break;
+            }
+            if (rank(entry) != rank(*victim) ? rank(entry) > rank(*victim) : entry.g > victim->g) victim = &entry;
+        }
+        if (victim->key != key && victim->key != UINT32_MAX && victim->iteration == iteration) overflowed = true;
+        *victim = {key, (uint16_t)g, expanded, iteration};
+    }
+
+    /// true if the iteration left a state it cut by the threshold unexpanded
+    bool has_frontier(uint16_t iteration) const {
+        for (const Entry& entry : entries) {
+            if (entry.key != UINT32_MAX && entry.iteration == iteration && !entry.expanded) return true;
+        }
+        return false;
+    }
+};
+
+class IdaSearch {
+    static constexpr int FOUND = -1;
+    const vector<PatternDatabase>* pattern_databases;
+    TranspositionTable& table;
+    long long work_limit;          // states visited before the search gives up
+    GameState state;               // the one state the search edits in place
+    vector<StateIndex> path;       // indices from the start to the current state
+    uint16_t iteration = 0;
+
+    /// lower bound on the cost to the exit, INT_MAX if the exit is unreachable
+    int heuristic() const {
+        int h = calculate_heuristic(state);
+        if (pattern_databases) {
+            for (auto& database : *pattern_databases) {
+                int bound = database.lookup(state);
+                if (bound < 0) return INT_MAX;
+                h = max(h, bound);
+            }
+        }
+        return h;
+    }
+
+    /// returns FOUND, or the smallest f above the threshold below this state;
+    /// arrival is the move that reached it, for the pruning rules
+    int dfs(int g, int threshold, MoveCode arrival) {
+        if (gave_up || states_explored >= work_limit) {
+            gave_up = true;
+            return INT_MAX;
+        }
+        states_explored++;
+        StateIndex index = state.getIndex();
+        int h = is_goal_state(state) ? 0 : heuristic();
+        if (h == INT_MAX) return INT_MAX;
+        if (g + h > threshold) {
+            table.store(index, g, false, iteration);
+            return g + h;
+        }
+        if (h == 0 && is_goal_state(state)) {
+            path.pb(index);
+            return FOUND;
+        }
+        if (table.seen(index, g, iteration)) return INT_MAX;
+        table.store(index, g, true, iteration);
+        states_expanded++;
+        path.pb(index);
+
+        int next_threshold = INT_MAX;
+        auto descend = [&](int cost, MoveCode move) {
+            state.index_cached = false;
+            int t = dfs(g + cost, threshold, move);
+            if (t != FOUND) next_threshold = min(next_threshold, t);
+            return t == FOUND;
+        };
+
+        // pawn moves: resting spots and the exit, nearest first; the walks are
+        // collected before descending, since the descent edits the board
+        PawnPosition pawn = state.pawn_pos;
+        int walk_ends[NUM_CELLS + 1];
+        int walk_costs[NUM_CELLS + 1];
+        int num_walks = 0;
+        int blank = state.blank_pos.first * 3 + state.blank_pos.second;
+        for_each_pawn_walk([&] { return build_pawn_graph(state.board); }, pawn_slot(pawn), blank, arrival, &moves_pruned,
+                           [&](int end_slot, int walk_cost) {
+            walk_ends[num_walks] = end_slot;
+            walk_costs[num_walks++] = walk_cost;
+        });
+        for (int i = 0; i < num_walks; ++i) {
+            int end_slot = walk_ends[i];
+            // holes are on the ground floor
+            state.pawn_pos = end_slot == EXIT_PAWN_SLOT ? PawnPosition{{0, -1}, 1}
+                                                        : PawnPosition{{end_slot / 2 / 3, end_slot / 2 % 3}, 0};
+            bool found = descend(walk_costs[i], PAWN_ARRIVAL + pawn_slot(pawn));
+            state.pawn_pos = pawn;
+            state.index_cached = false;
+            if (found) return FOUND;
+        }
+
+        // slides, except the one that undoes the slide that led here
+        auto [br, bc] = state.blank_pos;
+        bool found = false;
+        for_each_slide(br * 3 + bc, pawn.first.first * 3 + pawn.first.second, arrival, &moves_pruned, [&](int d, int from) {
+            int nr = from / 3, nc = from % 3;
+            swap(state.board[br][bc], state.board[nr][nc]);
+            state.blank_pos = {nr, nc};
+            found = descend(1, d);
+            swap(state.board[br][bc], state.board[nr][nc]);
+            state.blank_pos = {br, bc};
+            state.index_cached = false;
+            return found;
+        });
+        if (found) return FOUND;
+
+        path.pop_back();
+        return next_threshold;
+    }
+
+public:
+    long long states_explored = 0;
+    long long states_expanded = 0;
+    long long moves_pruned = 0;
+    bool gave_up = false;          // set when run stopped at the work limit without an answer
+
+    IdaSearch(const GameState& initial_state, const vector<PatternDatabase>* pattern_databases, TranspositionTable& table,
+              long long work_limit)
+        : pattern_databases(pattern_databases), table(table), work_limit(work_limit), state(initial_state) {}
+
+    /// fills the state indices of an optimal path; false if the exit is
+    /// unreachable or the search gave up
+    bool run(vector<StateIndex>& solution) {
+        table.clear();
+        int threshold = heuristic();
+        while (threshold != INT_MAX) {
+            iteration++;
+            path.clear();
+            table.overflowed = false;
+            int t = dfs(0, threshold, NO_ARRIVAL);
+            if (t == FOUND) {
+                solution = path;
+                return true;
+            }
+            if (gave_up) return false;
+            if (!table.overflowed && !table.has_frontier(iteration)) return false;
+            threshold = t;
+        }
+        return false;
+    }
+};
+
+// Per-search scratch tables. The tables over the whole state space are
+// allocated by the first search of an arena that needs them and are never
+// cleared entry by entry: min_cost starts a new epoch, arrival is only read
+// along chains written by the current search. Each solving thread owns one
+// arena.
+struct SearchArena {
+    EpochCostTable min_cost;
+    vector<MoveCode> arrival;
+    EpochCostTable learned;                 // --starts and hint sessions: bounds from earlier searches
+    vector<StateIndex> reached;             // states the last search_with_bounds reached
+    BucketQueue open;
+    vector<BucketQueue> parallel_opens;     // HDA* only, one per search thread
+    SuccessorBuffer successors;
+    PackedSuccessors packed_successors;     // A* engines
+    SearchStats stats;                      // of the last solve
+    TranspositionTable transpositions;     // IDA* only
+    vector<uint32_t> closed;                // anytime only: pass that last expanded each state
+    uint32_t anytime_pass = 0;              // passes are numbered across cases, so closed is never reset
+    unique_ptr<PerimeterTable> perimeter;   // kept while consecutive cases share a tile set
+    TileSet perimeter_tiles{};
+
+    const PerimeterTable& perimeter_for(const TileSet& tiles, int radius) {
+        if (!perimeter || perimeter->getRadius() != radius || perimeter_tiles != tiles) {
+            perimeter = make_unique<PerimeterTable>(radius);
+            build_perimeter(tiles, *perimeter);
+            perimeter_tiles = tiles;
+        }
+        return *perimeter;
+    }
+
+    vector<PatternDatabase> pattern_databases;   // same, for the --pdb spec
+    TileSet pattern_tiles{};
+    string pattern_spec;
+
+    bool has_pattern_databases(const TileSet& tiles, const string& spec) const {
+        return pattern_spec == spec && pattern_tiles == tiles;
+    }
+
+    const vector<PatternDatabase>& pattern_databases_for(const TileSet& tiles, const string& spec) {
+        if (pattern_spec != spec || pattern_tiles != tiles) {
+            pattern_databases = make_pattern_databases(spec, tiles);
+            pattern_tiles = tiles;
+            pattern_spec = spec;
+        }
+        return pattern_databases;
+    }
+
+    void reset() {
+        if (arrival.empty()) arrival.resize(NUM_STATES);
+        min_cost.next_epoch();
+        open.clear();
+    }
+
+    /// allocates and touches the anytime engine's tables, so that a query's
+    /// budget is not spent on page faults
+    void prepare_anytime() {
+        reset();
+        if (closed.empty()) closed.assign(NUM_STATES, 0);
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Anytime weighted A* (ARA*)
+//
+// The open list is ordered by g + w * h, so the first solution arrives after
+// few expansions. The search then lowers w and runs another pass over the same
+// open list, costs and arrival moves, until the time budget is spent or the
+// solution is proven optimal. A state whose g drops after it was expanded in
+// the current pass is not reopened: it waits in an INCONS list and joins the
+// open list of the next pass.
+//
+// The hand-written heuristic is too weak on hard boards for any weight to cut
+// the first pass much below exact A*. Without --pdb the search therefore runs
+// on the ACDEH pattern database whenever it is at hand: built by an earlier
+// query of the arena, or written by --build-pdb. ACDEH keeps one tile of each
+// pair of identical tiles (A and B, D and E), so one five-tile database covers
+// every tile shape, and on it a hard board has a first solution in about 15 ms.
+// The database is never built inside a query, whose budget is far below the
+// build. The budget is wall-clock time from the start of the query and is
+// hard: when it runs out before a first solution the answer is unknown.
+//
+// The heuristic is admissible but not necessarily consistent, so w itself is
+// not a guaranteed bound. Instead, some state of an optimal path always waits
+// in the open or INCONS list with its optimal g, hence min(g + h) over both
+// lists is a lower bound on the optimum and cost / that minimum is reported.
+// ---------------------------------------------------------------------------
+
+constexpr int WEIGHT_SCALE = 10;   // weights are kept in tenths so that keys stay integers
+constexpr const char* ANYTIME_PATTERN_DATABASES = "ACDEH";   // the fallback without --pdb
+
+/// searches until the deadline; returns false and prints nothing if the
+/// deadline passes before a first solution
+bool solve_anytime(const Puzzle& puzzle, SearchArena& arena, const vector<PatternDatabase>* pattern_databases,
+                   high_resolution_clock::time_point deadline, SolveResult& result, ostream& err) {
+    const GameState& initial_state = puzzle.initial_state;
+    const TileSet& tiles = puzzle.tiles;
+    arena.reset();
+    if (arena.closed.empty()) arena.closed.assign(NUM_STATES, 0);
+    EpochCostTable& min_cost = arena.min_cost;
+    BucketQueue& open = arena.open;
+    SuccessorBuffer& successors = arena.successors;
+
+    const PerimeterTable* perimeter = nullptr;
+    if (options().perimeter_radius > 0) perimeter = &arena.perimeter_for(tiles, options().perimeter_radius);
+    // h of a state, or -1 if a pattern database proves the exit unreachable
+    auto heuristic = [&](const GameState& state) {
+        STATS_TIMER(heuristic_ns);
+        int h = state.heuristic_cost - state.cost_so_far;
+        if (pattern_databases) {
+            for (auto& database : *pattern_databases) {
+                int bound = database.lookup(state);
+                if (bound < 0) return -1;
+                h = max(h, bound);
+            }
+        }
+        return perimeter ? perimeter->heuristic(state.getIndex(), h) : h;
+    };
+
+    auto start = high_resolution_clock::now();
+    auto elapsed_ms = [&] { return duration_cast<milliseconds>(high_resolution_clock::now() - start).count(); };
+
+    int weight = max(WEIGHT_SCALE, (int)lround(options().weight * WEIGHT_SCALE));
+    uint32_t pass = ++arena.anytime_pass;
+    auto push = [&](StateIndex index, int g, int h) {
+        open.push(index, g * WEIGHT_SCALE + weight * h, g * WEIGHT_SCALE);
+    };
+    vector<pair<StateIndex, int>> incons, queued;   // (state, h)
+
+    int best_cost = INT_MAX;
+    StateIndex best_goal = 0;
+    long long states_explored = 0, pruned = 0;
+
+    auto relax = [&](GameState& next_state, const GameState& current_state) {
+        StateIndex next_index = next_state.getIndex();
+        int best = next_state.cost_so_far, known = min_cost.get(next_index);
+        if (best >= known) return;
+        STATS(search_counters.min_cost_entries += known == INT_MAX);
+        min_cost.set(next_index, best);
+        arena.arrival[next_index] = arrival_move(current_state, next_state);
+        if (is_goal_state(next_state)) {
+            if (best < best_cost) best_cost = best, best_goal = next_index;
+            return;
+        }
+        int h = heuristic(next_state);
+        if (h < 0) return;
+        if (arena.closed[next_index] == pass) incons.pb({next_index, h});
+        else push(next_index, best, h);
+    };
+
+    int initial_h = heuristic(initial_state);
+    min_cost.set(initial_state.getIndex(), 0);
+    STATS(search_counters.min_cost_entries++);
+    if (initial_h >= 0) push(initial_state.getIndex(), 0, initial_h);
+
+    STATS(search_counters.engine = "anytime");
+    double bound = 0;
+    for (;;) {
+        // one pass: expand while some key is below the weighted key of the solution
+        bool expired = false;
+        while (!open.empty() && (long long)best_cost * WEIGHT_SCALE > open.top_f()) {
+            if ((states_explored & 63) == 0 && high_resolution_clock::now() >= deadline) {
+                expired = true;
+                break;
+            }
+            int key, scaled_g;
+            StateIndex current_index;
+            {
+                STATS_TIMER(pop_ns);
+                current_index = open.pop(key, scaled_g);
+            }
+            int g = scaled_g / WEIGHT_SCALE;
+            if (g > min_cost.get(current_index) || arena.closed[current_index] == pass) {
+                STATS(search_counters.stale_pops++);
+                continue;
+            }
+            arena.closed[current_index] = pass;
+            states_explored++;
+
+            GameState current_state = decode_state(current_index, tiles);
+            current_state.cost_so_far = g;
+            current_state.heuristic_cost = g + (key - scaled_g) / weight;
+            MoveCode arrival = current_index == initial_state.getIndex() ? NO_ARRIVAL : arena.arrival[current_index];
+            {
+                STATS_TIMER(generate_ns);
+                find_successors(current_state, successors, arrival, &pruned);
+            }
+            arena.stats.expanded++;
+            arena.stats.generated += successors.count;
+            for (auto& next_state : successors) relax(next_state, current_state);
+        }
+
+        if (expired && best_cost == INT_MAX) return false;
+
+        // everything still waiting, for the bound and the next pass
+        queued.swap(incons);
+        incons.clear();
+        while (!open.empty()) {
+            int key, scaled_g;
+            StateIndex index = open.pop(key, scaled_g);
+            if (scaled_g / WEIGHT_SCALE != min_cost.get(index) || arena.closed[index] == pass) continue;
+            queued.pb({index, (key - scaled_g) / weight});
+        }
+        sort(all(queued));
+        queued.erase(unique(all(queued)), queued.end());
+        long long lower = INT_MAX;
+        for (auto [index, h] : queued) lower = min<long long>(lower, min_cost.get(index) + h);
+
+        if (best_cost == INT_MAX && queued.empty()) break;
+        if (best_cost != INT_MAX) {
+            bound = lower >= best_cost ? 1.0 : (double)best_cost / max(lower, 1LL);
+            err << "Anytime: cost " << best_cost << " within " << fixed << setprecision(2) << bound
+                << " of optimal (weight " << (double)weight / WEIGHT_SCALE << ", " << elapsed_ms() << " ms, "
+                << states_explored << " states explored)" << defaultfloat << endl;
+            if (bound == 1.0 || expired) break;
+        }
+
+        weight = WEIGHT_SCALE + (weight - WEIGHT_SCALE) / 2;
+        pass = ++arena.anytime_pass;
+        for (auto [index, h] : queued) push(index, min_cost.get(index), h);
+        queued.clear();
+    }
+
+    if (best_cost == INT_MAX) {
+        result.status = SolveStatus::NO_SOLUTION;
+        return true;
+    }
+    vector<GameState> path;
+    if (!reconstruct_path(decode_state(best_goal, tiles), arena.arrival, initial_state, path)) {
+        err << "Error: Could not reconstruct path fully." << endl;
+    }
+    record_solution(path, result, bound);
+    err << "States explored: " << states_explored << " (anytime, " << pruned << " moves pruned, bound "
+        << fixed << setprecision(2) << bound << defaultfloat << ")" << endl;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Start families
+//
+// --starts pawn answers a tile layout for the pawn on every cell a puzzle's
+// pawn field accepts, and --starts all additionally for the blank swapped with
+// every cell. The starts share a
+// tile set and the exit, so each search leaves bounds for the next ones. When a
+// start costs C, a state it reached at cost g is at least C - g from the exit.
+// When a start has no solution, no state it reached has one either. Later
+// searches take the larger of this bound and the heuristic, and drop known
+// dead states, so they expand far less of what earlier starts already covered.
+// A start proven dead before its own search is answered at once, and so is one
+// the --use-reach bitset rules out. A backward Dijkstra from the exit states
+// was tried as well; it settles most of the component under the costliest
+// start, which is slower than these searches except on the hardest layouts.
+// ---------------------------------------------------------------------------
+
+/// the family of the parsed puzzle in output order: blank placements in cell
+/// order, then the pawn on every cell, as parse_puzzle places it (blank and
+/// tiles without a hole included)
+vector<GameState> start_family(const GameState& initial) {
+    vector<GameState> starts;
+    auto [br, bc] = initial.blank_pos;
+    for (int blank = 0; blank < NUM_CELLS; ++blank) {
+        if (command_line.start_family == StartFamily::PAWN_CELLS && blank != br * 3 + bc) continue;
+        GameState board;
+        board.board = initial.board;
+        swap(board.board[br][bc], board.board[blank / 3][blank % 3]);
+        board.blank_pos = {blank / 3, blank % 3};
+        for (int cell = 0; cell < NUM_CELLS; ++cell) {
+            board.pawn_pos = {{cell / 3, cell % 3}, 0};
+            starts.pb(board);
+        }
+    }
+    return starts;
+}
+
+constexpr int LEARNED_DEAD = 0xFFFF;   // arena.learned: the exit is unreachable
+
+/// A* from start with its heuristic raised by the bounds in arena.learned,
+/// which it then extends with the states it reached. Returns the cost, or
+/// INT_MAX if the exit is unreachable, and leaves the exit state in goal.
+int search_with_bounds(const GameState& start, const TileSet& tiles, SearchArena& arena, long long& states_explored, StateIndex& goal) {
+    EpochCostTable& learned = arena.learned;
+    StateIndex start_index = start.getIndex();
+    if (learned.get(start_index) == LEARNED_DEAD) return INT_MAX;
+
+    arena.reset();
+    EpochCostTable& min_cost = arena.min_cost;
+    BucketQueue& open = arena.open;
+    vector<StateIndex>& reached = arena.reached;
+    reached.clear();
+    // f of a state, or -1 if an earlier search proved the exit unreachable
+    auto estimate = [&](PackedState state, StateIndex index, int g) {
+        int bound = learned.get(index);
+        if (bound == LEARNED_DEAD) return -1;
+        int h = packed_heuristic(state, tiles);
+        return g + (bound == INT_MAX ? h : max(h, bound));
+    };
+    min_cost.set(start_index, 0);
+    reached.pb(start_index);
+    STATS(search_counters.min_cost_entries++);
+    if (int f = estimate(unpack_index(start_index), start_index, 0); f >= 0) open.push(start_index, f, 0);
+
+    int cost = INT_MAX;
+    while (!open.empty()) {
+        int f, g;
+        StateIndex index = open.pop(f, g);
+        if (g > min_cost.get(index)) continue;
+        PackedState state = unpack_index(index);
+        if (packed_is_goal(state)) {
+            cost = g;
+            goal = index;
+            break;
+        }
+        states_explored++;
+        MoveCode arrival = index == start_index ? NO_ARRIVAL : arena.arrival[index];
+        find_packed_successors(state, tiles, arena.packed_successors, arrival);
+        StateIndex board_index = index - packed_pawn(state);
+        for (const PackedMove& move : arena.packed_successors) {
+            StateIndex next_index = move.arrival >= PAWN_ARRIVAL ? board_index + packed_pawn(move.state) : packed_index(move.state);
+            int next_g = g + move.cost, known = min_cost.get(next_index);
+            if (next_g >= known) continue;
+            if (known == INT_MAX) {
+                reached.pb(next_index);
+                STATS(search_counters.min_cost_entries++);
+            }
+            min_cost.set(next_index, next_g);
+            arena.arrival[next_index] = move.arrival;
+            int next_f = estimate(move.state, next_index, next_g);
+            if (next_f >= 0) open.push(next_index, next_f, next_g);
+        }
+    }
+
+    // every state reached lies on a path from start: its cost to the exit is
+    // at least cost - g, and infinite if start has none
+    for (StateIndex index : reached) {
+        int known = learned.get(index), g = min_cost.get(index);
+        if (cost == INT_MAX) learned.set(index, LEARNED_DEAD);
+        else if (cost - g > (known == INT_MAX ? 0 : known)) learned.set(index, cost - g);
+    }
+    return cost;
+}
+
+/// costs of the family; unsolvable starts print "none"
+void solve_start_family(const Puzzle& puzzle, SearchArena& arena, ostream& out, ostream& err) {
+    vector<GameState> starts = start_family(puzzle.initial_state);
+    const ReachabilityTable* reachability = options().use_reachability ? load_reachability(puzzle.tiles) : nullptr;
+    arena.learned.next_epoch();
+
+    vector<int> costs;
+    long long states_explored = 0, solved_from_bounds = 0;
+    for (const GameState& start : starts) {
+        StateIndex start_index = start.getIndex(), goal;
+        if ((reachability && !reachability->reachable(start_index)) || arena.learned.get(start_index) == LEARNED_DEAD) {
+            costs.pb(INT_MAX);
+            solved_from_bounds++;
+            continue;
+        }
+        costs.pb(search_with_bounds(start, puzzle.tiles, arena, states_explored, goal));
+    }
+    arena.stats = {states_explored, states_explored};
+
+    if (command_line.output_format == OutputFormat::BOARDS) {
+        // one 3x3 grid per blank placement, the cost of each pawn start in its cell
+        for (size_t i = 0; i < starts.size();) {
+            auto [br, bc] = starts[i].blank_pos;
+            array<string, NUM_CELLS> cells;
+            cells.fill("    ");
+            cells[br * 3 + bc] = "  - ";
+            out << "Board " << puzzle_string(starts[i]).substr(0, 2 * NUM_CELLS) << " (blank at (" << br << ","
+                << bc << ")), cost by pawn start:" << '\n';
+            for (; i < starts.size() && starts[i].blank_pos == pair(br, bc); ++i) {
+                auto [r, c] = starts[i].pawn_pos.first;
+                ostringstream cost;
+                cost << setw(4) << costs[i];
+                cells[r * 3 + c] = costs[i] == INT_MAX ? "none" : cost.str();
+            }
+            for (int r = 0; r < 3; ++r) {
+                out << "  ";
+                for (int c = 0; c < 3; ++c) out << "[" << cells[r * 3 + c] << "]";
+                out << '\n';
+            }
+        }
+    } else {
+        for (size_t i = 0; i < starts.size(); ++i) {
+            out << puzzle_string(starts[i]) << ' ';
+            if (costs[i] == INT_MAX) out << "none\n";
+            else out << costs[i] << '\n';
+        }
+    }
+    err << "Start family: " << starts.size() << " starts, " << states_explored << " states explored, "
+        << solved_from_bounds << " answered without a search" << endl;
+}
+
+/// solves one parsed puzzle under options(), writing diagnostics to err
+void solve_puzzle(const Puzzle& puzzle, SearchArena& arena, SolveResult& result, ostream& err) {
+    arena.stats = {};
+    if (options().use_reachability && reject_unreachable(puzzle, result, err)) {
+        STATS(search_counters.engine = "reach");
+        return;
+    }
+    if (options().use_distance_table && solve_with_distance_table(puzzle, result, err)) {
+        STATS(search_counters.engine = "table");
+        return;
+    }
+    if (options().search_threads > 1) {
+        arena.reset();
+        return solve_parallel(puzzle, options().search_threads, arena.min_cost, arena.arrival, arena.parallel_opens,
+                              arena.stats, result, err);
+    }
+
+    const GameState& initial_state = puzzle.initial_state;
+    const TileSet& tiles = puzzle.tiles;
+    // the anytime budget is wall-clock time from here, table builds included
+    auto deadline = options().budget_ms > 0 ? high_resolution_clock::now() + milliseconds(options().budget_ms)
+                                          : high_resolution_clock::time_point::max();
+    const vector<PatternDatabase>* pattern_databases = nullptr;
+    if (!options().pattern_databases.empty()) pattern_databases = &arena.pattern_databases_for(tiles, options().pattern_databases);
+    if (options().engine == SearchEngine::ANYTIME) {
+        if (!pattern_databases && (arena.has_pattern_databases(tiles, ANYTIME_PATTERN_DATABASES) ||
+                                   pattern_databases_on_disk(ANYTIME_PATTERN_DATABASES, tiles))) {
+            pattern_databases = &arena.pattern_databases_for(tiles, ANYTIME_PATTERN_DATABASES);
+        }
+        if (solve_anytime(puzzle, arena, pattern_databases, deadline, result, err)) return;
+        err << "Anytime: no solution within " << options().budget_ms << " ms";
+        if (!pattern_databases) err << " (--build-pdb writes the " << ANYTIME_PATTERN_DATABASES << " pattern database)";
+        err << endl;
+        result.status = SolveStatus::UNKNOWN;
+        return;
+    }
+
+    if (options().engine == SearchEngine::IDA) {
+        STATS(search_counters.engine = "ida");
+        // an unsolvable board is what runs IDA* into its limit, so a built bitset answers first
+        if (!options().use_reachability && load_reachability(tiles) && reject_unreachable(puzzle, result, err)) {
+            STATS(search_counters.engine = "reach");
+            return;
+        }
+        arena.transpositions.resize(options().transposition_bytes);
+        long long work_limit = options().ida_work_limit > 0 ? options().ida_work_limit
+                                                          : IDA_WORK_PER_ENTRY * (long long)arena.transpositions.capacity();
+        IdaSearch search(initial_state, pattern_databases, arena.transpositions, work_limit);
+        vector<StateIndex> indices;
+        vector<GameState> path;
+        bool solved = search.run(indices);
+        arena.stats = {search.states_expanded, search.states_explored};
+        if (solved) {
+            if (!rebuild_path(indices, initial_state, path)) err << "Error: Could not reconstruct path fully." << endl;
+            record_solution(path, result);
+            err << "States explored: " << search.states_explored << " (IDA*, " << search.moves_pruned << " moves pruned, "
+                << arena.transpositions.bytes() / 1024 << " KB transposition table)" << endl;
+            return;
+        }
+        if (!search.gave_up) {
+            result.status = SolveStatus::NO_SOLUTION;
+            return;
+        }
+        err << "IDA*: no answer after " << search.states_explored << " states with a "
+            << arena.transpositions.bytes() / 1024 << " KB transposition table (raise --ida-limit or --tt-mb)" << endl;
+        result.status = SolveStatus::UNKNOWN;
+        return;
+    }
+    arena.reset();
+    EpochCostTable& min_cost = arena.min_cost;
+    BucketQueue& open = arena.open;
+
+    const PerimeterTable* perimeter = nullptr;
+    if (options().perimeter_radius > 0) perimeter = &arena.perimeter_for(tiles, options().perimeter_radius);
+    // f of a state, or -1 if a pattern database proves the exit unreachable
+    auto estimate = [&](PackedState state, StateIndex index, int g) {
+        int h = packed_heuristic(state, tiles);
+        if (pattern_databases) {
+            STATS_TIMER(heuristic_ns);
+            for (auto& database : *pattern_databases) {
+                int bound = database.lookup(state);
+                if (bound < 0) return -1;
+                h = max(h, bound);
+            }
+        }
+        return g + (perimeter ? perimeter->heuristic(index, h) : h);
+    };
+
+    StateIndex start_index = initial_state.getIndex();
+    int initial_f = estimate(unpack_index(start_index), start_index, 0);
+    if (initial_f >= 0) open.push(start_index, initial_f, 0);
+    min_cost.set(start_index, 0);
+    STATS(search_counters.min_cost_entries++);
+
+    PackedSuccessors& successors = arena.packed_successors;
+    StateIndex solution_index = 0;
+    bool solution_found = false;
+
+    int states_explored = 0;
+    long long duplicates = 0, pruned = 0;
+
+    STATS(search_counters.engine = "astar");
+    while (!open.empty()) {
+        int f, g;
+        StateIndex current_index;
+        {
+            STATS_TIMER(pop_ns);
+            current_index = open.pop(f, g);
+        }
+
+        states_explored++;
+
+        if (g > min_cost.get(current_index)) {
+            STATS(search_counters.stale_pops++);
+            continue;
+        }
+
+        PackedState current = unpack_index(current_index);
+
+        // inside the perimeter f is exact, so the first one popped is optimal
+        if (packed_is_goal(current) || (perimeter && perimeter->lookup(current_index) >= 0)) {
+            solution_index = current_index;
+            solution_found = true;
+            break;
+        }
+
+        MoveCode arrival = current_index == start_index ? NO_ARRIVAL : arena.arrival[current_index];
+        {
+            STATS_TIMER(generate_ns);
+            find_packed_successors(current, tiles, successors, arrival, &pruned);
+        }
+        arena.stats.expanded++;
+        arena.stats.generated += successors.count;
+        StateIndex board_index = current_index - packed_pawn(current);
+        for (const PackedMove& move : successors) {
+            // a walk keeps the board, so only a slide needs ranking
+            StateIndex next_index = move.arrival >= PAWN_ARRIVAL ? board_index + packed_pawn(move.state) : packed_index(move.state);
+            int next_g = g + move.cost, known = min_cost.get(next_index);
+            if (next_g >= known) {
+                duplicates++;
+                continue;
+            }
+            STATS(search_counters.min_cost_entries += known == INT_MAX);
+            min_cost.set(next_index, next_g);
+            arena.arrival[next_index] = move.arrival;
+            int next_f;
+            {
+                // the successors' heuristic counts as generation, as in the other engines
+                STATS_TIMER(generate_ns);
+                next_f = estimate(move.state, next_index, next_g);
+            }
+            if (next_f >= 0) open.push(next_index, next_f, next_g);
+            STATS(search_counters.inserted++);
+            STATS(search_counters.open_high_water = max<long long>(search_counters.open_high_water, open.size()));
+        }
+    }
+
+    if (solution_found) {
+        vector<GameState> path;
+        if (!reconstruct_path(decode_state(solution_index, tiles), arena.arrival, initial_state, path)) {
+            err << "Error: Could not reconstruct path fully." << endl;
+        }
+        if (perimeter && !descend_perimeter(*perimeter, path)) err << "Error: perimeter is inconsistent with the move generator." << endl;
+        record_solution(path, result);
+        err << "States explored: " << states_explored << " (" << duplicates << " duplicates generated, "
+            << pruned << " moves pruned)";
+        if (perimeter) err << " (perimeter radius " << perimeter->getRadius() << ": " << perimeter->size() << " states)";
+        if (pattern_databases) err << " (pattern databases " << options().pattern_databases << ")";
+        err << endl;
+    } else {
+        result.status = SolveStatus::NO_SOLUTION;
+    }
+}
+
+#ifdef TEMPLE_TRAP_STATS
+/// writes s as a JSON string literal; the puzzle is raw input and may hold anything
+void write_json_string(const string& s, ostream& out) {
+    out << '"';
+    for (unsigned char ch : s) {
+        if (ch == '"' || ch == '\\') out << '\\' << ch;
+        else if (ch < 0x20) out << "\\u00" << "0123456789abcdef"[ch >> 4] << "0123456789abcdef"[ch & 15];
+        else out << ch;
+    }
+    out << '"';
+}
+
+/// one JSON object per test case with the counters of its search
+void write_stats_json(const string& puzzle, const SearchArena& arena, long long total_ns, ostream& err) {
+    const SearchCounters& c = search_counters;
+    err << "{\"puzzle\":";
+    write_json_string(puzzle, err);
+    err << ",\"engine\":\"" << c.engine << "\""
+        << ",\"expanded\":" << arena.stats.expanded << ",\"generated\":" << arena.stats.generated
+        << ",\"inserted\":" << c.inserted << ",\"stale_pops\":" << c.stale_pops
+        << ",\"open_high_water\":" << c.open_high_water
+        << ",\"min_cost_entries\":" << c.min_cost_entries
+        << ",\"min_cost_load\":" << (double)c.min_cost_entries / NUM_STATES
+        << ",\"pawn_nodes_visited\":" << c.pawn_nodes_visited
+        << ",\"pop_ns\":" << c.pop_ns << ",\"generate_ns\":" << c.generate_ns
+        << ",\"heuristic_ns\":" << c.heuristic_ns << ",\"hash_ns\":" << c.hash_ns
+        << ",\"total_ns\":" << total_ns << "}\n";
+}
+#endif
+
+}  // namespace
+
+// ---------------------------------------------------------------------------
+// Library interface (solver.h)
+// ---------------------------------------------------------------------------
+
+struct temple_trap::Solver::State {
+    SolverOptions options;
+    SearchArena arena;
+};
+
+temple_trap::Solver::Solver(const SolverOptions& options) : state(make_unique<State>()) {
+    state->options = options;
+    // the anytime engine's tables are allocated here, outside any query's budget
+    if (options.engine == SearchEngine::ANYTIME) state->arena.prepare_anytime();
+}
+
+temple_trap::Solver::~Solver() = default;
+temple_trap::Solver::Solver(Solver&&) noexcept = default;
+temple_trap::Solver& temple_trap::Solver::operator=(Solver&&) noexcept = default;
+
+const SolverOptions& temple_trap::Solver::options() const { return state->options; }
+
+SolveResult temple_trap::Solver::solve(const string& puzzle) {
+    ostringstream log;
+    return solve(puzzle, log);
+}
+
+SolveResult temple_trap::Solver::solve(const string& s, ostream& log) {
+    OptionsScope scope(state->options);
+    SearchArena& arena = state->arena;
+    SolveResult result;
+    Puzzle puzzle;
+    if (!parse_puzzle(s, puzzle, log)) return result;
+#ifdef TEMPLE_TRAP_STATS
+    search_counters = {};
+    auto start = high_resolution_clock::now();
+    solve_puzzle(puzzle, arena, result, log);
+    write_stats_json(s, arena, duration_cast<nanoseconds>(high_resolution_clock::now() - start).count(), log);
+#else
+    solve_puzzle(puzzle, arena, result, log);
+#endif
+    result.expanded = arena.stats.expanded;
+    result.generated = arena.stats.generated;
+    return result;
+}
+
+namespace {
+
+/// prints a library result for puzzle string s in command_line.output_format;
+/// the board format replays the moves on the puzzle
+void print_result(const string& s, const SolveResult& result, ostream& out) {
+    Puzzle puzzle;
+    ostringstream ignored;   // solve() has reported the parse errors already
+    if (result.status == SolveStatus::INVALID || !parse_puzzle(s, puzzle, ignored)) return print_invalid(out);
+    const GameState& start = puzzle.initial_state;
+    if (result.status == SolveStatus::NO_SOLUTION) return print_no_solution(start, out);
+    if (result.status == SolveStatus::UNKNOWN) return print_unknown(start, out);
+
+    vector<GameState> path{start};
+    for (const Move& move : result.moves) {
+        GameState next = path.back();
+        if (move.pawn) {
+            next.pawn_pos = move.target == EXIT_CELL ? PawnPosition{{0, -1}, 1} : PawnPosition{{move.target / 3, move.target % 3}, 0};
+        } else {
+            auto [br, bc] = next.blank_pos;
+            int nr = br + SLIDE_DR[move.target], nc = bc + SLIDE_DC[move.target];
+            next.board[br][bc] = next.board[nr][nc];
+            next.board[nr][nc] = NO_TILE;
+            next.blank_pos = {nr, nc};
+        }
+        next.cost_so_far += move.cost;
+        next.index_cached = false;
+        path.pb(next);
+    }
+    print_solution(path, out, result.bound);
+}
+
+/// the command line's per-thread solver: a library Solver with the options
+/// main parsed, whose results it prints, and the start families (--starts),
+/// which answer many starts per puzzle
+class CaseSolver {
+    temple_trap::Solver solver;
+    SearchArena family_arena;
+
+public:
+    explicit CaseSolver(const SolverOptions& options) : solver(options) {}
+
+    /// solves one 20-character test case string, writing the answer in
+    /// command_line.output_format to out and diagnostics to err
+    void solve(const string& s, ostream& out, ostream& err) {
+        if (command_line.start_family == StartFamily::ONE) return print_result(s, solver.solve(s, err), out);
+        OptionsScope scope(solver.options());
+        Puzzle puzzle;
+        if (!parse_puzzle(s, puzzle, err)) return print_invalid(out);
+        family_arena.stats = {};
+#ifdef TEMPLE_TRAP_STATS
+        search_counters = {};
+        search_counters.engine = "family";
+        auto start = high_resolution_clock::now();
+        solve_start_family(puzzle, family_arena, out, err);
+        write_stats_json(s, family_arena, duration_cast<nanoseconds>(high_resolution_clock::now() - start).count(), err);
+#else
+        solve_start_family(puzzle, family_arena, out, err);
+#endif
+    }
+};
+
+/// Interactive hints on one puzzle: hint() takes a position and play() the
+/// player's move from the last one, and both answer with an optimal solution
+/// from the new position. This is Adaptive A*: each query reruns A*, and what
+/// carries over is the heuristic. The graph and the exit never change between
+/// queries, only the start does, so the bounds every search leaves in
+/// arena.learned stay admissible for the rest of the session (see Start
+/// families). A position on the last optimal path is answered from that path,
+/// without a search. One that leaves it gets a new search, which the bounds
+/// confine mostly to states the earlier searches have not reached. A puzzle
+/// with another tile set starts a new session.
+class HintSession {
+    SearchArena arena;
+    TileSet tiles{};
+    bool started = false;
+    vector<GameState> path;   // optimal path from the current position; empty if there is none
+    GameState position;
+    long long states_explored = 0;
+
+    void replan(GameState state, ostream& out, ostream& err) {
+        state.cost_so_far = 0;
+        state.heuristic_cost = calculate_heuristic(state);
+        states_explored = 0;
+        for (size_t k = 0; k < path.size(); ++k) {
+            if (path[k].getIndex() != state.getIndex()) continue;
+            path.erase(path.begin(), path.begin() + k);
+            int base = path[0].cost_so_far;
+            for (GameState& step : path) step.cost_so_far -= base;
+            position = path[0];
+            print_solution(path, out);
+            err << "Hint: on the previous path, 0 states explored" << endl;
+            return;
+        }
+
+        position = state;
+        path.clear();
+        StateIndex goal;
+        int cost = search_with_bounds(state, tiles, arena, states_explored, goal);
+        if (cost == INT_MAX) {
+            print_no_solution(state, out);
+            err << "Hint: no solution, " << states_explored << " states explored" << endl;
+            return;
+        }
+        if (!reconstruct_path(decode_state(goal, tiles), arena.arrival, state, path)) {
+            err << "Error: Could not reconstruct path fully." << endl;
+        }
+        print_solution(path, out);
+        err << "Hint: " << states_explored << " states explored" << endl;
+    }
+
+public:
+    /// a hint from the position of a 20-character test case string
+    void hint(const string& s, ostream& out, ostream& err) {
+        Puzzle puzzle;
+        if (!parse_puzzle(s, puzzle, err)) return print_invalid(out);
+        if (!started || puzzle.tiles != tiles) {
+            arena.learned.next_epoch();
+            tiles = puzzle.tiles;
+            path.clear();
+            started = true;
+        }
+        replan(puzzle.initial_state, out, err);
+    }
+
+    /// a hint after the player's move from the last position, written as in
+    /// the compact format: U, R, D or L for the blank, P<row><col> or PX for
+    /// the pawn (a ":<cost>" suffix is ignored)
+    void play(const string& move, ostream& out, ostream& err) {
+        string name = move.substr(0, move.find(':'));
+        int code = -1;
+        if (name.size() == 1 && strchr(SLIDE_NAMES, name[0])) code = strchr(SLIDE_NAMES, name[0]) - SLIDE_NAMES;
+        else if (name == "PX") code = PAWN_MOVE_FLAG | EXIT_CELL;
+        else if (name.size() == 3 && name[0] == 'P' && is_valid_board_pos(name[1] - '0', name[2] - '0')) {
+            code = PAWN_MOVE_FLAG | ((name[1] - '0') * 3 + name[2] - '0');
+        }
+        if (started) {
+            SuccessorBuffer successors;
+            find_successors(position, successors);
+            for (auto& next : successors) {
+                if (encode_move(position, next) == code) return replan(next, out, err);
+            }
+        }
+        err << "Illegal move " << move << (started ? "" : " (no position yet)") << endl;
+        print_invalid(out);
+    }
+
+    /// states the last hint's search expanded (0 when it came from the path)
+    long long last_states_explored() const { return states_explored; }
+};
+
+// ---------------------------------------------------------------------------
+// Other board sizes
+//
+// BoardSolver<Geometry> runs A* on any board of up to 16 cells, with tiles
+// taken from a TileDefinitions table, so that 3x4 and 4x4 packs can be designed
+// without touching the dense 3x3 engine. Such state spaces are far too large
+// for flat tables: a state is a node in a pool and a hash map finds it by its
+// packed board (4 bits per cell: the tile type, or 15 for the blank) and pawn
+// slot, while the bucket queue holds node ids. The pawn graph, the heuristic,
+// the walk generator with its pruning and the printers are the templates the
+// 3x3 engine instantiates for ClassicGeometry, here with the board's geometry.
+// An unsolvable board's component can run to billions of states, so a search
+// that has stored command_line.board_state_limit states answers unknown.
+// ---------------------------------------------------------------------------
+
+constexpr int MAX_TILE_TYPES = 15;   // a packed cell holds a tile type or the blank in 4 bits
+
+struct TileDefinitions {
+    int count = 0;
+    array<TileInfo, MAX_TILE_TYPES * NUM_ORIENTATIONS> table{};
+
+    void define(int type, const TileInfo& base) {
+        for (int orient = 0; orient < NUM_ORIENTATIONS; ++orient) table[type * NUM_ORIENTATIONS + orient] = rotate_tile(base, orient);
+        count = max(count, type + 1);
+    }
+};
+
+/// tiles A-H of the original game
+[[maybe_unused]] TileDefinitions builtin_tile_definitions() {
+    TileDefinitions tiles;
+    for (int type = 0; type < NUM_TILE_TYPES; ++type) tiles.define(type, BASE_TILES[type]);
+    return tiles;
+}
+
+/// Tile definition file: one tile per line in letter order from A, as
+///   <letter> <top openings> <ground openings> <hole 0|1> <stairs direction or -1>
+/// with the openings written like BASE_TILES (bit 0 = N ... bit 3 = W, so 1000
+/// opens to the west). '#' starts a comment.
+[[maybe_unused]] bool load_tile_definitions(const string& path, TileDefinitions& tiles, ostream& err) {
+    ifstream in(path);
+    if (!in) {
+        err << "Cannot open " << path << endl;
+        return false;
+    }
+    auto parse_mask = [](const string& bits, uint8_t& mask) {
+        if (bits.size() != 4 || bits.find_first_not_of("01") != string::npos) return false;
+        mask = stoi(bits, nullptr, 2);
+        return true;
+    };
+    tiles = {};
+    string line;
+    for (int line_number = 1; getline(in, line); ++line_number) {
+        istringstream fields(line.substr(0, line.find('#')));
+        string letter, top, ground;
+        int hole, stairs;
+        if (!(fields >> letter)) continue;
+        TileInfo base{};
+        if (!(fields >> top >> ground >> hole >> stairs) || tiles.count == MAX_TILE_TYPES ||
+            letter != string(1, 'A' + tiles.count) || !parse_mask(top, base.top_mask) ||
+            !parse_mask(ground, base.ground_mask) || hole < 0 || hole > 1 || stairs < -1 || stairs > 3) {
+            err << path << ":" << line_number << ": expected \"" << (char)('A' + tiles.count)
+                << " <top> <ground> <hole> <stairs>\" (at most " << MAX_TILE_TYPES << " tiles)" << endl;
+            return false;
+        }
+        base.hole = hole;
+        base.stairs = stairs;
+        tiles.define(tiles.count, base);
+    }
+    if (tiles.count == 0) err << path << ": no tiles defined" << endl;
+    return tiles.count > 0;
+}
+
+/// the board solvers behind one interface, chosen by --board at run time
+struct VariantSolver {
+    virtual ~VariantSolver() = default;
+    virtual void solve(const string& s, ostream& out, ostream& err) = 0;
+};
+
+template <typename Geometry>
+class BoardSolver : public VariantSolver {
+    static constexpr int ROWS = Geometry::NUM_ROWS;
+    static constexpr int COLS = Geometry::NUM_COLS;
+    static constexpr int CELLS = Geometry::NUM_CELLS;
+    static constexpr int EXIT_SLOT = Geometry::NUM_NODES;
+    static constexpr uint64_t BLANK_TYPE = 15;
+
+    using Board = BoardView<Geometry>;   // cost is the g of the node it was unpacked from
+
+    struct Node {
+        uint64_t packed;
+        uint8_t pawn;
+        uint8_t move;        // arrival move, as in the compact output
+        uint8_t step_cost;   // cost of the arrival move
+        int g;
+        uint32_t parent;
+    };
+
+    struct KeyHash {
+        size_t operator()(const pair<uint64_t, uint8_t>& key) const {
+            return (key.first ^ (uint64_t)key.second << 58 ^ key.second) * 0x9E3779B97F4A7C15ull >> 16;
+        }
+    };
+
+    const TileDefinitions& tiles;
+    array<int, MAX_TILE_TYPES> orientations{};   // of the current puzzle's tiles
+    vector<Node> nodes;
+    unordered_map<pair<uint64_t, uint8_t>, uint32_t, KeyHash> ids;
+    BucketQueue open;
+
+    uint64_t pack(const Board& board) const {
+        uint64_t packed = 0;
+        for (int cell = 0; cell < CELLS; ++cell) {
+            uint64_t type = board.cells[cell] == NO_TILE ? BLANK_TYPE : board.cells[cell] / NUM_ORIENTATIONS;
+            packed |= type << (4 * cell);
+        }
+        return packed;
+    }
+
+    Board unpack(const Node& node) const {
+        Board board;
+        for (int cell = 0; cell < CELLS; ++cell) {
+            int type = node.packed >> (4 * cell) & 15;
+            if (type == (int)BLANK_TYPE) {
+                board.cells[cell] = NO_TILE;
+                board.blank = cell;
+            } else {
+                board.cells[cell] = type * NUM_ORIENTATIONS + orientations[type];
+            }
+        }
+        board.pawn = node.pawn;
+        board.cost = node.g;
+        return board;
+    }
+
+    bool parse(const string& s, Board& board, ostream& err) {
+        if ((int)s.size() != 2 * CELLS + 2) {
+            err << "Invalid input length. Expected " << 2 * CELLS + 2 << " characters." << endl;
+            return false;
+        }
+        unsigned seen = 0;
+        board.blank = -1;
+        board.cost = 0;
+        for (int cell = 0; cell < CELLS; ++cell) {
+            char type = s[2 * cell], orient_ch = s[2 * cell + 1];
+            if (type == '-' && orient_ch == '-') {
+                if (board.blank != -1) {
+                    err << "Invalid board: more than one blank tile." << endl;
+                    return false;
+                }
+                board.blank = cell;
+                board.cells[cell] = NO_TILE;
+                continue;
+            }
+            int t = type - 'A', orient = orient_ch - '0';
+            if (t < 0 || t >= tiles.count || (seen >> t & 1) || orient < 0 || orient >= NUM_ORIENTATIONS) {
+                err << "Invalid board: tile " << type << orient_ch << " at cell " << cell
+                    << " is unknown, repeated or badly oriented." << endl;
+                return false;
+            }
+            seen |= 1u << t;
+            orientations[t] = orient;
+            board.cells[cell] = t * NUM_ORIENTATIONS + orient;
+        }
+        int r = s[2 * CELLS] - '0', c = s[2 * CELLS + 1] - '0';
+        if (board.blank == -1 || !Geometry::on_board(r, c)) {
+            err << "Invalid board: no blank, or pawn position (" << r << "," << c << ") off the board." << endl;
+            return false;
+        }
+        board.pawn = (r * COLS + c) * 2;
+        return true;
+    }
+
+    int heuristic(const Board& board) const {
+        int link = Geometry::LINK_CELL;
+        uint8_t link_top_mask = board.blank == link ? 0 : tiles.table[board.cells[link]].top_mask;
+        return exit_heuristic<Geometry>(board.pawn, board.blank, link_top_mask);
+    }
+
+    /// calls visit(next, move_cost, move) for every successor the pruning rules
+    /// keep after the given arrival move, pawn moves first
+    template <typename Visit>
+    void for_each_successor(const Board& board, MoveCode arrival, Visit&& visit) const {
+        Board next = board;
+        auto make_graph = [&] { return pawn_graph_of<Geometry>([&](int cell) { return board.cells[cell]; }, tiles.table); };
+        for_each_pawn_walk<Geometry>(make_graph, board.pawn, board.blank, arrival, nullptr, [&](int end_slot, int walk_cost) {
+            next.pawn = end_slot;
+            visit(next, walk_cost, PAWN_MOVE_FLAG | (end_slot == EXIT_SLOT ? CELLS : end_slot / 2));
+        });
+
+        for_each_slide<Geometry>(board.blank, board.pawn / 2, arrival, nullptr, [&](int d, int from) {
+            next = board;
+            next.cells[board.blank] = board.cells[from];
+            next.cells[from] = NO_TILE;
+            next.blank = from;
+            visit(next, 1, d);
+        });
+    }
+
+    /// the path from start to the goal node; step costs are summed along the
+    /// path because a parent's g may have dropped after the link was made
+    vector<Board> solution_path(const Board& start, uint32_t goal) const {
+        vector<const Node*> steps;
+        for (uint32_t id = goal; id != 0; id = nodes[id].parent) steps.pb(&nodes[id]);
+        reverse(all(steps));
+        vector<Board> path{start};
+        for (const Node* step : steps) {
+            path.pb(unpack(*step));
+            path.back().cost = path[path.size() - 2].cost + step->step_cost;
+        }
+        return path;
+    }
+
+public:
+    explicit BoardSolver(const TileDefinitions& tiles) : tiles(tiles) {}
+
+    void solve(const string& s, ostream& out, ostream& err) override {
+        Board start;
+        if (!parse(s, start, err)) return print_invalid(out);
+        nodes.clear();
+        ids.clear();
+        open.clear();
+
+        // node 0 is the start; a node's step cost is kept because its parent's
+        // g may still drop after the link was made
+        auto reach = [&](const Board& board, int g, uint32_t parent, uint8_t move, int step_cost) {
+            auto [it, inserted] = ids.try_emplace({pack(board), (uint8_t)board.pawn}, nodes.size());
+            if (inserted) {
+                nodes.pb({it->first.first, (uint8_t)board.pawn, move, (uint8_t)step_cost, g, parent});
+            } else {
+                Node& node = nodes[it->second];
+                if (g >= node.g) return;
+                node.g = g;
+                node.parent = parent;
+                node.move = move;
+                node.step_cost = step_cost;
+            }
+            open.push(it->second, g + heuristic(board), g);
+        };
+        reach(start, 0, 0, 0, 0);
+
+        long long states_explored = 0;
+        uint32_t goal = 0;
+        while (!open.empty()) {
+            // about 85 bytes per stored state, map and open list included
+            if (nodes.size() >= command_line.board_state_limit) {
+                err << "No answer after storing " << nodes.size() << " states (raise --state-limit)" << endl;
+                return print_unknown(start, out);
+            }
+            int f, g;
+            uint32_t id = open.pop(f, g);
+            if (g > nodes[id].g) continue;
+            Board board = unpack(nodes[id]);
+            if (board.pawn == EXIT_SLOT) {
+                goal = id;
+                break;
+            }
+            states_explored++;
+            // the pruning only tells a walk from a slide, not where the walk began
+            uint8_t move = nodes[id].move;
+            MoveCode arrival = id == 0 ? NO_ARRIVAL : move & PAWN_MOVE_FLAG ? PAWN_ARRIVAL : move;
+            for_each_successor(board, arrival, [&](const Board& next, int cost, uint8_t next_move) {
+                reach(next, g + cost, id, next_move, cost);
+            });
+        }
+
+        if (goal == 0) return print_no_solution(start, out);
+        print_solution(solution_path(start, goal), out);
+        err << "States explored: " << states_explored << " (" << ROWS << "x" << COLS << " board, "
+            << nodes.size() << " states stored)" << endl;
+    }
+};
+
+/// the board sizes compiled in, by their --board name
+[[maybe_unused]] unique_ptr<VariantSolver> make_variant_solver(const string& board, const TileDefinitions& tiles) {
+    if (board == "3x3") return make_unique<BoardSolver<ClassicGeometry>>(tiles);
+    if (board == "3x4") return make_unique<BoardSolver<BoardGeometry<3, 4, 0, -1>>>(tiles);
+    if (board == "4x4") return make_unique<BoardSolver<BoardGeometry<4, 4, 0, -1>>>(tiles);
+    return nullptr;
+}
+
+/// Solves independent test cases on a pool of workers. Every worker owns a
+/// deque of cases and an arena; an idle worker steals from the back of the
+/// others' deques. Results are written in input order as soon as every
+/// earlier case is done, so output.txt does not depend on scheduling.
+void solve_batch(const vector<string>& cases, int num_threads) {
+    struct WorkQueue {
+        mutex lock;
+        deque<int> items;
+    };
+    int n = cases.size();
+    vector<WorkQueue> queues(num_threads);
+    // contiguous blocks keep each worker close to the write position
+    for (int i = 0; i < n; ++i) queues[(long long)i * num_threads / n].items.pb(i);
+
+    vector<string> outputs(n), errors(n);
+    vector<char> ready(n, 0);
+    mutex output_lock;
+    int next_to_write = 0;
+    const SolverOptions& parsed = options();   // the workers' own options() are the defaults
+
+    auto take = [&](int worker, int& item) {
+        for (int k = 0; k < num_threads; ++k) {
+            WorkQueue& queue = queues[(worker + k) % num_threads];
+            lock_guard<mutex> guard(queue.lock);
+            if (queue.items.empty()) continue;
+            if (k == 0) {
+                item = queue.items.front();
+                queue.items.pop_front();
+            } else {
+                item = queue.items.back();
+                queue.items.pop_back();
+            }
+            return true;
+        }
+        return false;
+    };
+
+    auto work = [&](int worker) {
+        CaseSolver solver(parsed);
+        int item;
+        while (take(worker, item)) {
+            ostringstream out, err;
+            solver.solve(cases[item], out, err);
+            lock_guard<mutex> guard(output_lock);
+            outputs[item] = out.str();
+            errors[item] = err.str();
+            ready[item] = 1;
+            for (; next_to_write < n && ready[next_to_write]; ++next_to_write) {
+                cout << outputs[next_to_write];
+                cerr << errors[next_to_write];
+                string().swap(outputs[next_to_write]);
+                string().swap(errors[next_to_write]);
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for (int w = 0; w < num_threads; ++w) workers.emplace_back(work, w);
+    for (auto& worker : workers) worker.join();
+}
+
+// ---------------------------------------------------------------------------
+// Benchmarking
+//
+// --generate N --cost C writes N solvable puzzles of optimal cost exactly C in
+// the input.txt format; with --cost C+ the cost is the largest one of each tile
+// set, skipping tile sets whose largest cost is below C. For a random tile set
+// the reverse Dijkstra of the distance tables labels every state with its
+// exact cost, and a few puzzles are drawn from the states at the target cost
+// before moving on to the next tile set. Puzzles are distinct as physical
+// boards: copies of a tile (A/B, D/E) and orientations that look alike (F1, G0
+// and H3) would otherwise turn one board into several puzzle strings.
+// --bench FILE... solves each corpus file with the current options and prints
+// one row per file: total cost (which must not change between configurations),
+// nodes expanded and generated, throughput, latency percentiles and peak RSS.
+// ---------------------------------------------------------------------------
+
+/// the board as the pawn sees it: the openings, hole and stairs of every cell
+/// and the pawn slot, so that puzzle strings of one physical board are equal
+string physical_board_key(const GameState& state) {
+    string key;
+    for (auto& row : state.board) {
+        for (TileCode tile : row) {
+            if (tile == NO_TILE) {
+                key += "\xFF\xFF";
+                continue;
+            }
+            const TileInfo& info = tile_info(tile);
+            key += (char)(info.top_mask << 4 | info.ground_mask);
+            key += (char)(info.hole << 4 | (info.stairs + 1));
+        }
+    }
+    key += (char)pawn_slot(state.pawn_pos);
+    return key;
+}
+
+[[maybe_unused]] void generate_puzzles(int count, int target, bool hardest, unsigned seed) {
+    constexpr int PER_TILE_SET = 4;
+    constexpr int MAX_TILE_SETS = 1000;
+    mt19937 rng(seed);
+    vector<string> puzzles;
+    unordered_set<string> boards;
+    vector<uint16_t> dist;
+    for (int sets = 0; (int)puzzles.size() < count && sets < MAX_TILE_SETS; ++sets) {
+        TileSet tiles;
+        for (int i = 0; i < BLANK_SLOT; ++i) tiles[i] = make_tile_code('A' + i, rng() % NUM_ORIENTATIONS);
+        build_distance_table(tiles, dist);
+        // puzzles start with the pawn on the ground floor of a tile
+        auto is_puzzle = [&](StateIndex index) {
+            int slot = index % PAWN_SLOTS;
+            if (dist[index] == DISTANCE_UNSETTLED || slot == EXIT_PAWN_SLOT || slot % 2) return false;
+            return decode_state(index, tiles).board[slot / 2 / 3][slot / 2 % 3] != NO_TILE;
+        };
+        int cost = target;
+        if (hardest) {
+            for (StateIndex index = 0; index < NUM_STATES; ++index) {
+                if (dist[index] > cost && is_puzzle(index)) cost = dist[index];
+            }
+        }
+        vector<StateIndex> candidates;
+        for (StateIndex index = 0; index < NUM_STATES; ++index) {
+            if (dist[index] == cost && is_puzzle(index)) candidates.pb(index);
+        }
+        cerr << "Tile set " << tile_set_key(tiles) << ": " << candidates.size() << " puzzles of cost " << cost << endl;
+        for (int k = 0; k < PER_TILE_SET && !candidates.empty() && (int)puzzles.size() < count;) {
+            size_t pick = rng() % candidates.size();
+            GameState state = decode_state(candidates[pick], tiles);
+            candidates[pick] = candidates.back();
+            candidates.pop_back();
+            if (!boards.insert(physical_board_key(state)).second) continue;
+            puzzles.pb(puzzle_string(state));
+            ++k;
+        }
+    }
+    if ((int)puzzles.size() < count) cerr << "Only " << puzzles.size() << " puzzles of the requested cost found." << endl;
+    cout << puzzles.size() << '\n';
+    for (auto& puzzle : puzzles) cout << puzzle << '\n';
+}
+
+inline double peak_rss_mb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+[[maybe_unused]] void run_benchmark(const vector<string>& files) {
+    cout << left << setw(24) << "corpus" << right << setw(6) << "cases" << setw(8) << "cost" << setw(12) << "expanded"
+         << setw(12) << "generated" << setw(12) << "nodes/s" << setw(9) << "total_s" << setw(9) << "p50_ms"
+         << setw(9) << "p90_ms" << setw(9) << "p99_ms" << setw(9) << "max_ms" << setw(8) << "rss_mb" << '\n';
+    for (auto& file : files) {
+        ifstream in(file);
+        int t = 0;
+        if (!(in >> t)) {
+            cerr << "Cannot read " << file << endl;
+            continue;
+        }
+        vector<string> cases(max(t, 0));
+        for (auto& s : cases) in >> s;
+
+        temple_trap::Solver solver(options());
+        vector<double> latencies;
+        long long expanded = 0, generated = 0, total_cost = 0;
+        for (auto& s : cases) {
+            auto start = high_resolution_clock::now();
+            SolveResult result = solver.solve(s);
+            latencies.pb(duration<double, milli>(high_resolution_clock::now() - start).count());
+            expanded += result.expanded;
+            generated += result.generated;
+            if (result.status == SolveStatus::SOLVED) total_cost += result.cost;
+        }
+        double total_ms = 0;
+        for (double ms : latencies) total_ms += ms;
+        sort(all(latencies));
+        // nearest-rank percentile
+        auto percentile = [&](double p) {
+            if (latencies.empty()) return 0.0;
+            size_t rank = (size_t)ceil(p * latencies.size());
+            return latencies[max<size_t>(rank, 1) - 1];
+        };
+        cout << left << setw(24) << file << right << setw(6) << cases.size() << setw(8) << total_cost
+             << setw(12) << expanded << setw(12) << generated << setw(12) << (long long)(expanded / max(total_ms / 1000, 1e-9))
+             << fixed << setprecision(2) << setw(9) << total_ms / 1000 << setw(9) << percentile(0.5)
+             << setw(9) << percentile(0.9) << setw(9) << percentile(0.99) << setw(9) << percentile(1.0)
+             << setprecision(1) << setw(8) << peak_rss_mb() << '\n';
+        cout.unsetf(ios::floatfield);
+    }
+}
+
+/// next puzzle string of a stream: a text token (a leading case count is
+/// skipped) or a packed record; false at the end of the input
+bool read_puzzle(istream& in, bool binary, string& s) {
+    if (binary) {
+        unsigned char bytes[PACKED_PUZZLE_BYTES];
+        if (!in.read((char*)bytes, PACKED_PUZZLE_BYTES)) return false;
+        uint64_t packed = 0;
+        for (int i = PACKED_PUZZLE_BYTES - 1; i >= 0; --i) packed = packed << 8 | bytes[i];
+        if (!unpack_puzzle(packed, s)) s.clear();   // rejected by parse_puzzle
+        return true;
+    }
+    return (bool)(in >> s);
+}
+
+/// the "T" line of the input.txt format
+inline bool is_case_count(const string& s) {
+    return s.size() != 20 && all_of(all(s), ::isdigit);
+}
+
+/// solves puzzles as they are read, without a case count, writing to cout;
+/// batch mode works on bounded chunks so memory does not grow with the input
+/// (one at a time on a --board variant)
+[[maybe_unused]] void solve_stream(istream& in, bool binary, int num_threads, VariantSolver* variant) {
+    constexpr size_t CASES_PER_THREAD = 256;
+    if (num_threads <= 0) num_threads = max(1u, thread::hardware_concurrency());
+    CaseSolver solver(options());
+    vector<string> chunk;
+    string s;
+    bool first = true;
+    while (read_puzzle(in, binary, s)) {
+        if (first && !binary && is_case_count(s)) continue;
+        first = false;
+        if (variant) {
+            variant->solve(s, cout, cerr);
+            continue;
+        }
+        if (num_threads == 1) {
+            solver.solve(s, cout, cerr);
+            continue;
+        }
+        chunk.pb(s);
+        if (chunk.size() == CASES_PER_THREAD * num_threads) {
+            solve_batch(chunk, num_threads);
+            chunk.clear();
+        }
+    }
+    if (!chunk.empty()) solve_batch(chunk, min<int>(num_threads, chunk.size()));
+}
+
+/// --session: one hint per line on stdin, for a puzzle string or a move
+[[maybe_unused]] void run_session(istream& in) {
+    HintSession session;
+    string token;
+    while (in >> token) {
+        if (token.size() == 20) session.hint(token, cout, cerr);
+        else session.play(token, cout, cerr);
+        cout.flush();
+    }
+}
+
+/// converts text puzzles to packed records
+[[maybe_unused]] void pack_puzzles(istream& in) {
+    string s;
+    bool first = true;
+    while (in >> s) {
+        if (first && is_case_count(s)) continue;
+        first = false;
+        Puzzle puzzle;
+        if (!parse_puzzle(s, puzzle, cerr)) continue;
+        uint64_t packed = pack_puzzle(puzzle);
+        char bytes[PACKED_PUZZLE_BYTES];
+        for (int i = 0; i < PACKED_PUZZLE_BYTES; ++i) bytes[i] = packed >> (8 * i) & 0xFF;
+        cout.write(bytes, PACKED_PUZZLE_BYTES);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Server
+//
+// --serve answers puzzles from a long-running process, so that callers pay
+// neither process startup nor cold tables. Requests are lines: a puzzle string
+// is answered in the chosen output format (compact moves by default), "stats"
+// with one JSON line of latency statistics, and "quit" closes the connection.
+// Without --socket the protocol runs on stdin and stdout. With --socket PATH
+// every client of the Unix-domain socket gets a connection of its own. A
+// connection is answered in order, and connections are served concurrently by
+// a pool of --threads solvers, built at startup, whose arenas and per-tile-set
+// tables stay warm from one request to the next. The connection threads are
+// joined before serve returns, since they share the pool and the histogram.
+// ---------------------------------------------------------------------------
+
+/// request latencies in power-of-two microsecond buckets; bucket k counts
+/// latencies below 2^k us (and at least 2^(k-1))
+class LatencyHistogram {
+    static constexpr int BUCKETS = 40;
+    array<atomic<uint64_t>, BUCKETS> buckets{};
+    atomic<uint64_t> requests = 0, total_us = 0, max_us = 0;
+
+public:
+    void record(uint64_t us) {
+        buckets[min<int>(bit_width(us), BUCKETS - 1)]++;
+        requests++;
+        total_us += us;
+        for (uint64_t seen = max_us; us > seen && !max_us.compare_exchange_weak(seen, us);) {}
+    }
+
+    /// one JSON line; percentiles are the upper bound of their bucket
+    void write_json(ostream& out) const {
+        array<uint64_t, BUCKETS> counts;
+        for (int k = 0; k < BUCKETS; ++k) counts[k] = buckets[k];
+        uint64_t n = accumulate(all(counts), (uint64_t)0);
+        auto percentile = [&](double p) -> uint64_t {
+            uint64_t rank = max<uint64_t>((uint64_t)ceil(p * n), 1), seen = 0;
+            for (int k = 0; k < BUCKETS; ++k) {
+                if ((seen += counts[k]) >= rank) return min<uint64_t>((1ull << k) - 1, max_us);
+            }
+            return 0;
+        };
+        out << "{\"requests\":" << requests << ",\"mean_us\":" << (n ? total_us / n : 0)
+            << ",\"p50_us\":" << (n ? percentile(0.5) : 0) << ",\"p90_us\":" << (n ? percentile(0.9) : 0)
+            << ",\"p99_us\":" << (n ? percentile(0.99) : 0) << ",\"max_us\":" << max_us << ",\"histogram_us\":{";
+        bool first = true;
+        for (int k = 0; k < BUCKETS; ++k) {
+            if (!counts[k]) continue;
+            out << (first ? "" : ",") << "\"<" << (1ull << k) << "\":" << counts[k];
+            first = false;
+        }
+        out << "}}\n";
+    }
+};
+
+/// solvers shared by the connections; a request borrows one for its search
+class SolverPool {
+    vector<unique_ptr<CaseSolver>> idle;
+    mutex lock;
+    condition_variable available;
+
+public:
+    explicit SolverPool(int size) {
+        for (int i = 0; i < size; ++i) idle.pb(make_unique<CaseSolver>(options()));
+    }
+
+    unique_ptr<CaseSolver> acquire() {
+        unique_lock<mutex> guard(lock);
+        available.wait(guard, [&] { return !idle.empty(); });
+        unique_ptr<CaseSolver> solver = move(idle.back());
+        idle.pop_back();
+        return solver;
+    }
+
+    void release(unique_ptr<CaseSolver> solver) {
+        {
+            lock_guard<mutex> guard(lock);
+            idle.pb(move(solver));
+        }
+        available.notify_one();
+    }
+};
+
+/// stream buffer over a socket, so a connection reads and writes like stdin
+class SocketBuf : public streambuf {
+    int fd;
+    char in_buffer[4096], out_buffer[4096];
+
+    bool flush_out() {
+        for (char* p = pbase(); p < pptr();) {
+            ssize_t written = write(fd, p, pptr() - p);
+            if (written <= 0) return false;
+            p += written;
+        }
+        setp(out_buffer, out_buffer + sizeof(out_buffer));
+        return true;
+    }
+
+protected:
+    int underflow() override {
+        ssize_t got = read(fd, in_buffer, sizeof(in_buffer));
+        if (got <= 0) return traits_type::eof();
+        setg(in_buffer, in_buffer, in_buffer + got);
+        return traits_type::to_int_type(in_buffer[0]);
+    }
+
+    int overflow(int c) override {
+        if (!flush_out()) return traits_type::eof();
+        if (c != traits_type::eof()) sputc(c);
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override { return flush_out() ? 0 : -1; }
+
+public:
+    explicit SocketBuf(int fd) : fd(fd) {
+        setg(in_buffer, in_buffer, in_buffer);
+        setp(out_buffer, out_buffer + sizeof(out_buffer));
+    }
+    ~SocketBuf() override {
+        sync();
+        close(fd);
+    }
+};
+
+/// answers the requests of one connection until "quit" or the end of its input
+void serve_connection(istream& in, ostream& out, SolverPool& pool, LatencyHistogram& latencies) {
+    string line;
+    while (getline(in, line)) {
+        auto start = high_resolution_clock::now();
+        istringstream fields(line);
+        string request;
+        if (!(fields >> request)) continue;
+        if (request == "quit") break;
+        if (request == "stats") {
+            latencies.write_json(out);
+            out.flush();
+            continue;
+        }
+        unique_ptr<CaseSolver> solver = pool.acquire();
+        ostringstream err;   // diagnostics are not part of the protocol
+        solver->solve(request, out, err);
+        pool.release(move(solver));
+        latencies.record(duration_cast<microseconds>(high_resolution_clock::now() - start).count());
+        if (!out.flush()) break;
+    }
+}
+
+/// --serve: stdin and stdout, or every client of the socket at path
+[[maybe_unused]] int serve(const string& path, int num_threads) {
+    if (num_threads <= 0) num_threads = max(1u, thread::hardware_concurrency());
+    SolverPool pool(num_threads);
+    LatencyHistogram latencies;
+    if (path.empty()) {
+        serve_connection(cin, cout, pool, latencies);
+        return 0;
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        cerr << "Socket path too long: " << path << endl;
+        return 1;
+    }
+    strcpy(address.sun_path, path.c_str());
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0) {
+        cerr << "Cannot listen on " << path << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);   // a client that hangs up only ends its connection
+    cerr << "Serving on " << path << " with " << num_threads << " solvers" << endl;
+
+    // connection threads borrow pool and latencies, so serve joins every one
+    // before it returns; a finished thread is joined at the next accept
+    mutex lock;
+    unordered_map<long long, thread> connections;   // by connection number
+    unordered_map<long long, int> open_clients;     // sockets their thread has not closed yet
+    vector<long long> finished;
+    long long next_connection = 0;
+    auto join_finished = [&] {
+        vector<long long> done;
+        {
+            lock_guard<mutex> guard(lock);
+            done.swap(finished);
+        }
+        for (long long id : done) {
+            connections[id].join();
+            connections.erase(id);
+        }
+    };
+    while (true) {
+        int client = accept(listener, nullptr, nullptr);
+        join_finished();
+        if (client < 0) {
+            if (errno == EINTR) continue;
+            cerr << "accept: " << strerror(errno) << endl;
+            break;
+        }
+        lock_guard<mutex> guard(lock);
+        long long id = next_connection++;
+        open_clients[id] = client;
+        connections[id] = thread([id, client, &pool, &latencies, &lock, &open_clients, &finished] {
+            SocketBuf buffer(client);
+            iostream stream(&buffer);
+            serve_connection(stream, stream, pool, latencies);
+            // the guard is released before buffer closes the socket
+            lock_guard<mutex> guard(lock);
+            open_clients.erase(id);
+            finished.pb(id);
+        });
+    }
+
+    // end the open connections: their next read sees the end of input
+    close(listener);
+    {
+        lock_guard<mutex> guard(lock);
+        for (auto& [id, client] : open_clients) shutdown(client, SHUT_RDWR);
+    }
+    for (auto& [id, connection] : connections) connection.join();
+    return 1;
+}
+
+}  // namespace
+
+#ifndef TEMPLE_TRAP_NO_MAIN
+int main(int argc, char** argv) {
+    fastio();
+    // the filebuf behind cout is already open, so pubsetbuf would be ignored;
+    // give cout its own 1 MB buffer over stdout instead (kept alive past main
+    // for the exit-time flush, and still valid after the freopen below), and
+    // untie cerr, whose per-puzzle lines would otherwise flush it every time
+    cout.rdbuf(new __gnu_cxx::stdio_filebuf<char>(stdout, ios::out, 1 << 20));
+    cerr.tie(nullptr);
+    SolverOptions options;
+    current_options = &options;   // for the command line's own paths on this thread
+    bool build_db = false, build_reach = false, build_pdb = false, stream = false, binary_input = false, pack = false, format_set = false;
+    string input_path;
+    int generate = 0, generate_cost = 0;
+    bool generate_hardest = false;
+    unsigned seed = 1;
+    vector<string> bench_files;
+    int num_threads = 1;
+    string board = "3x3", tile_path, socket_path;
+    bool serve_requests = false, session = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--build-db") build_db = true;
+        else if (arg == "--use-db") options.use_distance_table = true;
+        else if (arg == "--build-reach") build_reach = true;
+        else if (arg == "--build-pdb") build_pdb = true;
+        else if (arg == "--use-reach") options.use_reachability = true;
+        else if (arg == "--db-dir" && i + 1 < argc) options.distance_table_dir = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc) num_threads = atoi(argv[++i]);
+        else if (arg == "--search-threads" && i + 1 < argc) options.search_threads = atoi(argv[++i]);
+        else if (arg == "--engine" && i + 1 < argc) {
+            string engine = argv[++i];
+            if (engine == "ida") options.engine = SearchEngine::IDA;
+            else if (engine == "astar") options.engine = SearchEngine::ASTAR;
+            else if (engine == "anytime") options.engine = SearchEngine::ANYTIME;
+            else {
+                cerr << "Unknown engine " << engine << endl;
+                return 1;
+            }
+        }
+        else if (arg == "--weight" && i + 1 < argc) options.weight = max(atof(argv[++i]), 1.0);
+        else if (arg == "--budget-ms" && i + 1 < argc) options.budget_ms = max(atoi(argv[++i]), 0);
+        else if (arg == "--tt-mb" && i + 1 < argc) options.transposition_bytes = (size_t)max(atoi(argv[++i]), 1) << 20;
+        else if (arg == "--ida-limit" && i + 1 < argc) options.ida_work_limit = max(atoll(argv[++i]), 1LL) * 1000000;
+        else if (arg == "--state-limit" && i + 1 < argc) command_line.board_state_limit = max(atoll(argv[++i]), 1LL) * 1000000;
+        else if (arg == "--pdb" && i + 1 < argc) options.pattern_databases = argv[++i];
+        else if (arg == "--perimeter" && i + 1 < argc) options.perimeter_radius = min(atoi(argv[++i]), 254);
+        else if (arg == "--stream") stream = true;
+        else if (arg == "--serve") serve_requests = true;
+        else if (arg == "--session") session = true;
+        else if (arg == "--socket" && i + 1 < argc) {
+            socket_path = argv[++i];
+            serve_requests = true;
+        }
+        else if (arg == "--input" && i + 1 < argc) {
+            input_path = argv[++i];
+            stream = true;
+        }
+        else if (arg == "--binary-input") binary_input = true;
+        else if (arg == "--pack") pack = true;
+        else if (arg == "--generate" && i + 1 < argc) generate = atoi(argv[++i]);
+        else if (arg == "--cost" && i + 1 < argc) {
+            string cost = argv[++i];
+            generate_hardest = cost.back() == '+';
+            generate_cost = atoi(cost.c_str());
+        }
+        else if (arg == "--starts" && i + 1 < argc) {
+            string starts = argv[++i];
+            if (starts == "one") command_line.start_family = StartFamily::ONE;
+            else if (starts == "pawn") command_line.start_family = StartFamily::PAWN_CELLS;
+            else if (starts == "all") command_line.start_family = StartFamily::BOARDS;
+            else {
+                cerr << "Unknown start family " << starts << endl;
+                return 1;
+            }
+        }
+        else if (arg == "--board" && i + 1 < argc) board = argv[++i];
+        else if (arg == "--tiles" && i + 1 < argc) tile_path = argv[++i];
+        else if (arg == "--seed" && i + 1 < argc) seed = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--bench") {
+            while (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) bench_files.pb(argv[++i]);
+        }
+        else if (arg == "--format" && i + 1 < argc) {
+            string format = argv[++i];
+            format_set = true;
+            if (format == "boards") command_line.output_format = OutputFormat::BOARDS;
+            else if (format == "moves") command_line.output_format = OutputFormat::MOVES;
+            else if (format == "binary") command_line.output_format = OutputFormat::BINARY;
+            else {
+                cerr << "Unknown format " << format << endl;
+                return 1;
+            }
+        }
+        else {
+            cerr << "Unknown option " << arg << endl;
+            return 1;
+        }
+    }
+
+    // HDA* runs plain A* on the hand-written heuristic
+    if (options.search_threads > 1 && (options.engine != SearchEngine::ASTAR || !options.pattern_databases.empty() ||
+                                       options.perimeter_radius > 0 || command_line.start_family != StartFamily::ONE)) {
+        cerr << "--search-threads does not combine with --engine, --pdb, --perimeter or --starts" << endl;
+        return 1;
+    }
+
+    // another board size or tile set: the templated solver replaces the 3x3 engine
+    TileDefinitions tiles = builtin_tile_definitions();
+    unique_ptr<VariantSolver> variant;
+    if (board != "3x3" || !tile_path.empty()) {
+        if (!tile_path.empty() && !load_tile_definitions(tile_path, tiles, cerr)) return 1;
+        variant = make_variant_solver(board, tiles);
+        if (!variant) {
+            cerr << "Unknown board " << board << " (3x3, 3x4 or 4x4)" << endl;
+            return 1;
+        }
+        if (binary_input || pack || serve_requests || session) {
+            cerr << "Packed puzzles, --serve and --session are 3x3 only" << endl;
+            return 1;
+        }
+        // the --board solver is plain A*: flags of the dense engine would be ignored
+        if (options.engine != SearchEngine::ASTAR || !options.pattern_databases.empty() || options.search_threads > 1 ||
+            command_line.start_family != StartFamily::ONE || options.use_distance_table || options.use_reachability ||
+            options.perimeter_radius > 0 || build_db || build_reach || build_pdb || generate > 0 || !bench_files.empty()) {
+            cerr << "--engine, --pdb, --search-threads, --starts, --use-db, --use-reach, --perimeter, --build-db, "
+                    "--build-reach, --build-pdb, --generate and --bench are 3x3 only" << endl;
+            return 1;
+        }
+    }
+
+    if (generate > 0 || !bench_files.empty()) {
+        if (generate > 0) generate_puzzles(generate, generate_cost, generate_hardest, seed);
+        else run_benchmark(bench_files);
+        cout.flush();
+        return 0;
+    }
+
+    if (session) {
+        if (!format_set) command_line.output_format = OutputFormat::MOVES;
+        run_session(cin);
+        return 0;
+    }
+
+    if (serve_requests) {
+        if (!format_set) command_line.output_format = OutputFormat::MOVES;
+        return serve(socket_path, num_threads);
+    }
+
+    // streaming: stdin (or --input) to stdout, compact moves unless asked otherwise
+    if (stream || pack) {
+        if (!format_set) command_line.output_format = OutputFormat::MOVES;
+        ifstream file;
+        if (!input_path.empty()) {
+            file.open(input_path, ios::binary);
+            if (!file) {
+                cerr << "Cannot open " << input_path << endl;
+                return 1;
+            }
+        }
+        istream& in = input_path.empty() ? cin : file;
+        if (pack) pack_puzzles(in);
+        else solve_stream(in, binary_input, num_threads, variant.get());
+        cout.flush();
+        return 0;
+    }
+
+    auto start = high_resolution_clock::now();
     freopen("input.txt", "r", stdin);
     freopen("output.txt", "w", stdout);
     freopen("error.txt", "w", stderr);
-    int t=1;
-    cin >> t; // comment to test one test case at a time
-    while (t--) {
-        solve();
+    if (build_db) {
+        build_distance_tables();
+    } else if (build_reach) {
+        build_reachability_tables();
+    } else if (build_pdb) {
+        build_pattern_database_files(options.pattern_databases.empty() ? ANYTIME_PATTERN_DATABASES : options.pattern_databases);
+    } else {
+        int t=1;
+        cin >> t; // comment to test one test case at a time
+        vector<string> cases(max(t, 0));
+        for (auto& s : cases) cin >> s;
+        if (num_threads <= 0) num_threads = max(1u, thread::hardware_concurrency());
+        num_threads = min<int>(num_threads, max<size_t>(cases.size(), 1));
+        if (variant) {
+            for (auto& s : cases) variant->solve(s, cout, cerr);
+        } else if (num_threads == 1) {
+            CaseSolver solver(options);
+            for (auto& s : cases) solver.solve(s, cout, cerr);
+        } else {
+            solve_batch(cases, num_threads);
+        }
     }
     auto end = high_resolution_clock::now();
     auto duration = duration_cast<microseconds>(end - start);
     cerr << "Time taken by the code: " << duration.count() << " microseconds" << endl;
+    cout.flush();
     fclose(stdin);
     fclose(stdout);
     fclose(stderr);
     return 0;
 }
+#endif
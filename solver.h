@@ -0,0 +1,82 @@
+// Temple Trap solver: library interface.
+//
+// Build solver.cpp with -DTEMPLE_TRAP_NO_MAIN and link it next to code that
+// includes this header. Everything else in solver.cpp has internal linkage.
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace temple_trap {
+
+enum class SearchEngine {
+    ASTAR,     // exact A* over the dense state index
+    IDA,       // low-memory IDA* with a fixed-size transposition table
+    ANYTIME,   // anytime weighted A* (ARA*) with a time budget
+};
+
+/// settings of one Solver, fixed when it is constructed
+struct SolverOptions {
+    SearchEngine engine = SearchEngine::ASTAR;  // --engine astar|ida|anytime
+    std::size_t transposition_bytes = 4 << 20;  // --tt-mb N: IDA* transposition table size
+    long long ida_work_limit = 0;               // --ida-limit N: states IDA* visits before it answers unknown; 0 scales it to the table
+    double weight = 1.5;                        // --weight W: first weight of the anytime engine
+    int budget_ms = 50;                         // --budget-ms MS: anytime time budget (0 = until optimal); unknown if it ends before a first answer
+    bool use_distance_table = false;            // --use-db: answer from precomputed tables
+    bool use_reachability = false;              // --use-reach: reject unsolvable puzzles from bitsets
+    std::string distance_table_dir = ".";       // --db-dir <dir>: where the tables and databases on disk live
+    int search_threads = 1;                     // --search-threads N: HDA* threads per puzzle
+    int perimeter_radius = 0;                   // --perimeter R: goal-side perimeter of cost R (0 = off)
+    std::string pattern_databases;              // --pdb ABCD,EFGH: tile groups of the pattern databases
+};
+
+enum class SolveStatus {
+    SOLVED,
+    NO_SOLUTION,   // the exit cannot be reached
+    INVALID,       // the puzzle string was rejected
+    UNKNOWN,       // the search stopped at its limit or budget
+};
+
+/// one move of a solution
+struct Move {
+    bool pawn;    // a pawn walk, else a tile slide
+    int target;   // slide: direction the blank moves (0-3: U, R, D, L); pawn: destination cell (row * 3 + column, 9 = exit)
+    int cost;     // 1 for a slide, the walk's cost for a pawn move
+};
+
+struct SolveResult {
+    SolveStatus status = SolveStatus::INVALID;
+    int cost = 0;                // total cost of moves when solved
+    std::vector<Move> moves;
+    double bound = 0;            // anytime engine: cost is within this factor of the optimum; 0 for the exact engines
+    long long expanded = 0;      // states whose successors were generated
+    long long generated = 0;     // successors produced by the move generators
+};
+
+/// Keeps every table sized to the state space, the open list's buckets and the
+/// per-tile-set perimeter and pattern databases alive from one query to the
+/// next, so a query only pays for the states it visits. A Solver is used by one
+/// thread at a time; Solvers on different threads may use different options.
+class Solver {
+public:
+    explicit Solver(const SolverOptions& options = {});
+    ~Solver();
+    Solver(Solver&&) noexcept;
+    Solver& operator=(Solver&&) noexcept;
+
+    /// solves one 20-character puzzle string
+    SolveResult solve(const std::string& puzzle);
+    /// the same, writing the search's diagnostics to log
+    SolveResult solve(const std::string& puzzle, std::ostream& log);
+
+    const SolverOptions& options() const;
+
+private:
+    struct State;
+    std::unique_ptr<State> state;
+};
+
+}  // namespace temple_trap
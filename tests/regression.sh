@@ -0,0 +1,68 @@
+#!/bin/sh
+# Regression checks: tests/regression.sh [path to the solver binary, default ./solver]
+solver=${1:-./solver}
+status=0
+
+check() {   # check <name> <expected first output token> <puzzle> <solver options...>
+    name=$1 expected=$2 puzzle=$3
+    shift 3
+    got=$(echo "$puzzle" | timeout 120 "$solver" --stream "$@" 2>/dev/null | cut -d' ' -f1)
+    if [ "$got" = "$expected" ]; then
+        echo "ok   $name"
+    else
+        echo "FAIL $name: expected '$expected', got '$got'"
+        status=1
+    fi
+}
+
+# an unsolvable board whose component fits in a 16 MB IDA* table but not in the default 4 MB one
+check "ida proves an unsolvable board" none H3--E0B0C0G2F1A3D202 --engine ida --tt-mb 16 --format moves
+check "ida stops at its work limit" unknown H3--E0B0C0G2F1A3D202 --engine ida --format moves
+# a cost-183 board that takes IDA* about 100 M states, past the default limit: no other engine
+check "ida solves a hard board" 183 C3H3D0E2A1B0--G3F110 --engine ida --ida-limit 200 --format moves
+
+# a 4x4 board whose pawn never moves: the --board solver stops at its state limit
+check "board solver stops at its state limit" unknown A0B0C0D0E0F0G0H0I0J0K0L0M0N0O0--00 \
+    --board 4x4 --tiles "$(dirname "$0")/sealed_tiles.txt" --state-limit 1
+
+# without its pattern database the anytime engine runs out of its 50 ms budget on a hard board
+check "anytime answers unknown past its budget" unknown C3H3D0E2A1B0--G3F110 --engine anytime --format moves
+
+# --build-reach works in the current directory (input.txt, error.txt); two tile
+# sets must not share one component count
+dir=$(mktemp -d)
+case $solver in /*) path=$solver ;; *) path=$PWD/$solver ;; esac
+printf '2\nH3--E0B0C0G2F1A3D202\nC3H3D0E2A1B0--G3F110\n' > "$dir/input.txt"
+(cd "$dir" && timeout 120 "$path" --build-reach)
+reports=$(sed -n 's/^Tile set [0-9]*: .* solvable, \(.*\), written to .*/\1/p' "$dir/error.txt" | sort -u | wc -l)
+if [ "$reports" -eq 2 ]; then
+    echo "ok   reach components differ per tile set"
+else
+    echo "FAIL reach components differ per tile set: $reports distinct reports"
+    status=1
+fi
+# with the bitset built, IDA* answers the unsolvable board without searching
+got=$(cd "$dir" && echo H3--E0B0C0G2F1A3D202 | timeout 120 "$path" --stream --engine ida --format moves 2>/dev/null)
+if [ "$got" = none ]; then
+    echo "ok   ida reads the reachability bitset"
+else
+    echo "FAIL ida reads the reachability bitset: expected 'none', got '$got'"
+    status=1
+fi
+# with the ACDEH database on disk, the anytime answer on hard boards: cost / bound <= optimum <= cost,
+# with the optimum from A*
+printf '2\nC3H3D0E2A1B0--G3F110\nH0G0B1F1A0--E3C2D010\n' > "$dir/input.txt"
+(cd "$dir" && timeout 120 "$path" --build-pdb)
+for puzzle in C3H3D0E2A1B0--G3F110 H0G0B1F1A0--E3C2D010; do
+    optimum=$(echo "$puzzle" | timeout 120 "$solver" --stream --format moves 2>/dev/null | cut -d' ' -f1)
+    answer=$(echo "$puzzle" | timeout 120 "$solver" --stream --engine anytime --db-dir "$dir" --format moves 2>/dev/null)
+    if echo "$answer" | awk -v optimum="$optimum" '{ cost = $1; if (!sub(/.*bound:/, "")) exit 1; exit !(cost >= optimum && cost <= $1 * optimum + 1e-9) }'; then
+        echo "ok   anytime bound holds on $puzzle"
+    else
+        echo "FAIL anytime bound holds on $puzzle: optimum $optimum, answer '$(echo "$answer" | cut -d' ' -f1) $(echo "$answer" | grep -o 'bound:.*')'"
+        status=1
+    fi
+done
+rm -rf "$dir"
+
+exit $status